@@ -0,0 +1,77 @@
+// Measures how independent script evaluations scale with threads. Each
+// thread owns one Interpreter and evaluates the same script repeatedly;
+// with no shared mutable state the throughput should grow close to
+// linearly up to the number of cores.
+//
+//   goku_isolate_bench [max_threads] [evaluations_per_thread]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace {
+
+const char kScript[] =
+    "let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };"
+    "let square = fn(x) { x * x };"
+    "let point = {\"x\": fib(15), \"y\": len(map(range(0, 64), square))};"
+    "point[\"x\"] + point[\"y\"]";
+
+// Returns the wall time of running evaluations on each of threads threads.
+double Run(int threads, int evaluations) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([evaluations]() {
+      Interpreter interpreter;
+      for (int j = 0; j < evaluations; ++j) {
+        std::shared_ptr<Object> ret = interpreter.Eval(kScript);
+        if (ret == nullptr || ret->Type() == ObjectType::kError) {
+          std::cerr << "evaluation failed: " << (ret == nullptr ? "null" : ret->Inspect()) << std::endl;
+          std::exit(1);
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int max_threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+  int evaluations = argc > 2 ? std::atoi(argv[2]) : 200;
+  if (max_threads < 1 || evaluations < 1) {
+    std::cerr << "usage: goku_isolate_bench [max_threads] [evaluations_per_thread]" << std::endl;
+    return 2;
+  }
+
+  std::cout << std::setw(8) << "threads" << std::setw(14) << "evals/s" << std::setw(10) << "speedup"
+            << std::setw(12) << "efficiency" << std::endl;
+  double base = 0;
+  std::vector<int> counts;
+  for (int threads = 1; threads < max_threads; threads *= 2) {
+    counts.push_back(threads);
+  }
+  counts.push_back(max_threads);
+  for (int threads : counts) {
+    double seconds = Run(threads, evaluations);
+    double rate = threads * evaluations / seconds;
+    if (threads == 1) {
+      base = rate;
+    }
+    std::cout << std::setw(8) << threads << std::setw(14) << std::fixed << std::setprecision(1) << rate
+              << std::setw(9) << std::setprecision(2) << rate / base << "x" << std::setw(11)
+              << std::setprecision(0) << 100 * rate / base / threads << "%" << std::endl;
+  }
+  return 0;
+}
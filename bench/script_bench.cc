@@ -0,0 +1,62 @@
+// Compares evaluating a rule script from source on every request with
+// calling it precompiled.
+//
+//   goku_script_bench [requests]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace {
+
+const char kRule[] =
+    "let total = sum(prices) * (100 - discount) / 100;"
+    "let tier = if (total > 1000) { \"gold\" } else { \"basic\" };"
+    "{\"total\": total, \"approved\": total < 5000, \"tier\": tier}";
+
+template <typename F>
+double Measure(int requests, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < requests; ++i) {
+    if (!f(i)) {
+      std::cerr << "evaluation failed" << std::endl;
+      std::exit(1);
+    }
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int requests = argc > 1 ? std::atoi(argv[1]) : 100000;
+  if (requests < 1) {
+    std::cerr << "usage: goku_script_bench [requests]" << std::endl;
+    return 2;
+  }
+  Interpreter interpreter;
+  std::vector<int64_t> prices = {120, 300, 990};
+  std::vector<std::string> errors;
+
+  double parsed = Measure(requests, [&](int i) {
+    // Inputs baked into the source, as a host without compiled scripts
+    // would have to.
+    std::string source = "let prices = [120, 300, 990]; let discount = " + std::to_string(i % 50) + ";" + kRule;
+    std::shared_ptr<const Script> script = interpreter.Compile(source, &errors);
+    return script != nullptr && interpreter.Call(*script).IsHash();
+  });
+
+  std::shared_ptr<const Script> rule = interpreter.Compile(kRule, &errors);
+  double compiled = Measure(requests, [&](int i) {
+    return interpreter.Call(*rule, {{"prices", prices}, {"discount", i % 50}}).IsHash();
+  });
+
+  std::cout << "parse per request: " << requests / parsed << " requests/s" << std::endl;
+  std::cout << "compiled script:   " << requests / compiled << " requests/s (" << parsed / compiled << "x)"
+            << std::endl;
+  return 0;
+}
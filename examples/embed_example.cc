@@ -0,0 +1,46 @@
+// An example of embedding goku: a rule script is compiled once and then
+// called for every request with that request's fields as inputs. Build it
+// with -DGOKU_BUILD_EXAMPLES=ON and link against the goku library.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace {
+
+const char kRule[] =
+    "let total = sum(prices) * (100 - discount) / 100;"
+    "{\"total\": total, \"approved\": total < limit, \"tier\": if (total > 1000) { \"gold\" } else { \"basic\" }}";
+
+}  // namespace
+
+int main() {
+  Interpreter interpreter;
+  interpreter.Bind("limit", std::make_shared<IntegerObject>(5000));
+
+  std::vector<std::string> errors;
+  std::shared_ptr<const Script> rule = interpreter.Compile(kRule, &errors);
+  if (rule == nullptr) {
+    for (auto& error : errors) {
+      std::cerr << error << std::endl;
+    }
+    return 1;
+  }
+
+  for (int64_t request = 1; request <= 3; ++request) {
+    Value result = interpreter.Call(*rule, {
+        {"prices", std::vector<int64_t>{120 * request, 300 * request, 990 * request}},
+        {"discount", request * 5},
+    });
+    if (result.IsError()) {
+      std::cerr << result.ErrorMessage() << std::endl;
+      return 1;
+    }
+    std::cout << "request " << request << ": total " << result.Get("total").AsInteger()
+              << ", approved " << result.Get("approved").AsBoolean() << ", tier "
+              << result.Get("tier").AsString() << std::endl;
+  }
+  return 0;
+}
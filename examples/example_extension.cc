@@ -0,0 +1,58 @@
+// An example native extension. Build it with -DGOKU_BUILD_EXAMPLES=ON and
+// load it with `goku --ext libgoku_example_extension.so`:
+//
+//   >> clamp(15, 0, 10)
+//   10
+//   >> histogram([1, 3, 3, 0], 4)
+//   [1,1,0,2,]
+
+#include <vector>
+
+#include "extension.h"
+
+namespace {
+
+const GokuHost* host = nullptr;
+
+std::shared_ptr<Object> Clamp(ObjectSpan args) {
+  if (args.size() != 3) {
+    return host->new_error("wrong number of arguments");
+  }
+  int64_t value, lo, hi;
+  if (!host->get_integer(args[0], &value) || !host->get_integer(args[1], &lo) ||
+      !host->get_integer(args[2], &hi)) {
+    return host->new_error("arguments to clamp must be Integer");
+  }
+  return host->new_integer(value < lo ? lo : value > hi ? hi : value);
+}
+
+// histogram(arr, buckets) counts the occurrences of 0 .. buckets-1.
+std::shared_ptr<Object> Histogram(ObjectSpan args) {
+  const int64_t* data;
+  size_t size;
+  int64_t buckets;
+  if (args.size() != 2 || host->type_of(args[0]) != ObjectType::kArray ||
+      !host->get_integer(args[1], &buckets)) {
+    return host->new_error("usage: histogram(arr, buckets)");
+  }
+  if (!host->get_int_array(args[0], &data, &size) || buckets < 0) {
+    return host->new_error("histogram needs an array of integers");
+  }
+  std::vector<int64_t> counts(buckets);
+  for (size_t i = 0; i < size; ++i) {
+    if (data[i] >= 0 && data[i] < buckets) {
+      ++counts[data[i]];
+    }
+  }
+  return host->new_int_array(counts.data(), counts.size());
+}
+
+}  // namespace
+
+extern "C" bool goku_extension_init(const GokuHost* h) {
+  if (h->abi_version != GOKU_EXTENSION_ABI_VERSION) {
+    return false;
+  }
+  host = h;
+  return host->register_builtin("clamp", Clamp) && host->register_builtin("histogram", Histogram);
+}
@@ -1,7 +1,136 @@
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/extension.h"
+#ifdef GOKU_HEATMAP
+#include "src/heatmap.h"
+#endif
+#include "src/profiler.h"
 #include "src/repl.h"
 
-int main() {
-  Start(std::cin, std::cout);
-  return 0;
+int main(int argc, char* argv[]) {
+  std::vector<std::string> extensions;
+  std::string snapshot;
+  std::string save_snapshot;
+  std::string script;
+  std::string profile;
+  bool stats = false;
+#ifdef GOKU_HEATMAP
+  std::string heatmap;
+#endif
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--ext" && i + 1 < argc) {
+      extensions.push_back(argv[++i]);
+    } else if (arg == "--snapshot" && i + 1 < argc) {
+      snapshot = argv[++i];
+    } else if (arg == "--save-snapshot" && i + 1 < argc) {
+      save_snapshot = argv[++i];
+    } else if (arg == "--profile" && i + 1 < argc) {
+      profile = argv[++i];
+    } else if (arg == "--stats") {
+      stats = true;
+#ifdef GOKU_HEATMAP
+    } else if (arg == "--heatmap" && i + 1 < argc) {
+      heatmap = argv[++i];
+#endif
+    } else if (script.empty() && (arg == "-" || arg[0] != '-')) {
+      script = arg;
+    } else {
+      std::cerr << "usage: goku [--ext library]... [--snapshot file] [--save-snapshot file]"
+                << " [--profile file] [--stats]"
+#ifdef GOKU_HEATMAP
+                << " [--heatmap file]"
+#endif
+                << " [file | -]" << std::endl;
+      return 2;
+    }
+  }
+  // Before anything creates objects, extensions included.
+  if (stats && !EnableObjectStats()) {
+    std::cerr << "cannot enable object statistics" << std::endl;
+    return 1;
+  }
+  for (auto& extension : extensions) {
+    std::string error = LoadExtension(extension);
+    if (!error.empty()) {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+  }
+  // Outlives the interpreter, whose unfinished tasks may still record calls.
+  std::unique_ptr<Profiler> profiler;
+  // Created after the extensions are loaded, so it binds their builtins.
+  Interpreter interpreter;
+  if (!snapshot.empty()) {
+    std::string error = interpreter.LoadSnapshot(snapshot);
+    if (!error.empty()) {
+      std::cerr << snapshot << ": " << error << std::endl;
+      return 1;
+    }
+  }
+  if (!profile.empty()) {
+    profiler = std::make_unique<Profiler>(interpreter.builtins());
+    Profiler::SetActive(profiler.get());
+  }
+  int status = 0;
+  std::string source;
+  if (script.empty()) {
+    Start(interpreter, std::cin, std::cout);
+  } else {
+    // Script mode reads everything up front, so stdio needs no syncing and
+    // output is flushed once at exit.
+    std::ios::sync_with_stdio(false);
+    std::ostringstream in;
+    if (script == "-") {
+      in << std::cin.rdbuf();
+    } else {
+      std::ifstream file(script, std::ios::binary);
+      if (!file) {
+        std::cerr << "cannot open " << script << std::endl;
+        return 1;
+      }
+      in << file.rdbuf();
+    }
+    source = in.str();
+    if (!RunScript(interpreter, source, std::cout, std::cerr)) {
+      status = 1;
+    }
+    std::cout.flush();
+  }
+  if (profiler != nullptr) {
+    Profiler::SetActive(nullptr);
+    std::ofstream collapsed(profile);
+    profiler->WriteCollapsed(collapsed);
+    if (!collapsed) {
+      std::cerr << "cannot write " << profile << std::endl;
+      status = 1;
+    }
+    profiler->WriteReport(std::cerr);
+  }
+  if (stats) {
+    WriteObjectStats(std::cerr);
+  }
+#ifdef GOKU_HEATMAP
+  if (!heatmap.empty()) {
+    std::ofstream out(heatmap);
+    WriteHeatmap(out, source);
+    if (!out) {
+      std::cerr << "cannot write " << heatmap << std::endl;
+      status = 1;
+    }
+  }
+#endif
+  if (!save_snapshot.empty()) {
+    std::string error = interpreter.SaveSnapshot(save_snapshot);
+    if (!error.empty()) {
+      std::cerr << save_snapshot << ": " << error << std::endl;
+      return 1;
+    }
+  }
+  return status;
 }
@@ -0,0 +1,599 @@
+#include "builtins.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "ast.h"
+
+// The kernels below are plain loops over unboxed int64 or double data
+// written so the compiler can vectorize them: independent accumulators, no
+// aliasing and no early exits. Arrays holding any float take the double
+// kernels, with integers promoted.
+
+namespace {
+
+using Ints = ArrayObject::Ints;
+using Floats = ArrayObject::Floats;
+
+std::shared_ptr<Object> Box(int64_t value) {
+  return std::make_shared<IntegerObject>(value);
+}
+
+std::shared_ptr<Object> Box(double value) {
+  return std::make_shared<FloatObject>(value);
+}
+
+// Views an array as unboxed integers, unboxing generic arrays of integers
+// into a temporary. Returns an error object for anything else.
+std::shared_ptr<Object> ToInts(const std::shared_ptr<Object>& obj, const std::string& name, Ints* out) {
+  if (obj->Type() != ObjectType::kArray) {
+    return std::make_shared<ErrorObject>("argument to " + name + " must be Array, got " + ObjectTypeToString(obj->Type()));
+  }
+  std::shared_ptr<ArrayObject> arr = std::static_pointer_cast<ArrayObject>(obj);
+  if (arr->IsInts()) {
+    *out = arr->ints;
+    return nullptr;
+  }
+  Ints ret = Ints::Uninitialized(arr->Size());
+  int64_t* data = ret.MutableData();
+  for (size_t i = 0; i < arr->Size(); ++i) {
+    std::shared_ptr<Object> elem = arr->At(i);
+    if (elem->Type() != ObjectType::kInteger) {
+      return std::make_shared<ErrorObject>("elements of " + name + " must be Integer or Float, got " + ObjectTypeToString(elem->Type()));
+    }
+    data[i] = static_cast<IntegerObject*>(elem.get())->value;
+  }
+  *out = ret;
+  return nullptr;
+}
+
+// Like ToInts, promoting integers to doubles.
+std::shared_ptr<Object> ToFloats(const std::shared_ptr<Object>& obj, const std::string& name, Floats* out) {
+  if (obj->Type() != ObjectType::kArray) {
+    return std::make_shared<ErrorObject>("argument to " + name + " must be Array, got " + ObjectTypeToString(obj->Type()));
+  }
+  std::shared_ptr<ArrayObject> arr = std::static_pointer_cast<ArrayObject>(obj);
+  if (arr->IsFloats()) {
+    *out = arr->floats;
+    return nullptr;
+  }
+  Floats ret = Floats::Uninitialized(arr->Size());
+  double* data = ret.MutableData();
+  if (arr->IsInts()) {
+    std::copy(arr->ints.data(), arr->ints.data() + arr->Size(), data);
+    *out = ret;
+    return nullptr;
+  }
+  for (size_t i = 0; i < arr->Size(); ++i) {
+    std::shared_ptr<Object> elem = arr->At(i);
+    if (elem->Type() == ObjectType::kInteger) {
+      data[i] = static_cast<IntegerObject*>(elem.get())->value;
+    } else if (elem->Type() == ObjectType::kFloat) {
+      data[i] = static_cast<FloatObject*>(elem.get())->value;
+    } else {
+      return std::make_shared<ErrorObject>("elements of " + name + " must be Integer or Float, got " + ObjectTypeToString(elem->Type()));
+    }
+  }
+  *out = ret;
+  return nullptr;
+}
+
+std::shared_ptr<Object> Unbox(const std::shared_ptr<Object>& obj, const std::string& name, Ints* out) {
+  return ToInts(obj, name, out);
+}
+
+std::shared_ptr<Object> Unbox(const std::shared_ptr<Object>& obj, const std::string& name, Floats* out) {
+  return ToFloats(obj, name, out);
+}
+
+// Whether a builtin should take the double kernels for this argument.
+bool HasFloats(const std::shared_ptr<Object>& obj) {
+  if (obj->Type() == ObjectType::kFloat) {
+    return true;
+  }
+  if (obj->Type() != ObjectType::kArray) {
+    return false;
+  }
+  ArrayObject* arr = static_cast<ArrayObject*>(obj.get());
+  if (!arr->IsGeneric()) {
+    return arr->IsFloats();
+  }
+  bool ret = false;
+  arr->ForEach([&ret](const std::shared_ptr<Object>& elem) {
+    ret = ret || elem->Type() == ObjectType::kFloat;
+  });
+  return ret;
+}
+
+template <typename T>
+T SumKernel(const T* __restrict data, size_t n) {
+  T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += data[i];
+    s1 += data[i + 1];
+    s2 += data[i + 2];
+    s3 += data[i + 3];
+  }
+  for (; i < n; ++i) {
+    s0 += data[i];
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+template <typename T>
+T MinKernel(const T* __restrict data, size_t n) {
+  T ret = data[0];
+  for (size_t i = 1; i < n; ++i) {
+    ret = data[i] < ret ? data[i] : ret;
+  }
+  return ret;
+}
+
+template <typename T>
+T MaxKernel(const T* __restrict data, size_t n) {
+  T ret = data[0];
+  for (size_t i = 1; i < n; ++i) {
+    ret = data[i] > ret ? data[i] : ret;
+  }
+  return ret;
+}
+
+template <typename T>
+T DotKernel(const T* __restrict lhs, const T* __restrict rhs, size_t n) {
+  T s0 = 0, s1 = 0;
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    s0 += lhs[i] * rhs[i];
+    s1 += lhs[i + 1] * rhs[i + 1];
+  }
+  for (; i < n; ++i) {
+    s0 += lhs[i] * rhs[i];
+  }
+  return s0 + s1;
+}
+
+template <typename T, typename Op>
+void ElementwiseKernel(const T* __restrict lhs, const T* __restrict rhs, T* __restrict out, size_t n, Op op) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = op(lhs[i], rhs[i]);
+  }
+}
+
+template <typename T, typename Op>
+void BroadcastKernel(const T* __restrict lhs, T rhs, T* __restrict out, size_t n, Op op) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = op(lhs[i], rhs);
+  }
+}
+
+// Runs fn on the unboxed argument, as Ints or as Floats.
+template <typename Fn>
+std::shared_ptr<Object> Reduce(const std::vector<std::shared_ptr<Object>>& args, const std::string& name,
+                               bool allow_empty, Fn fn) {
+  if (args.size() != 1) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (args[0]->Type() == ObjectType::kArray && !allow_empty && static_cast<ArrayObject*>(args[0].get())->Size() == 0) {
+    return std::make_shared<ErrorObject>("argument to " + name + " must not be empty");
+  }
+  if (HasFloats(args[0])) {
+    Floats floats;
+    std::shared_ptr<Object> err = ToFloats(args[0], name, &floats);
+    return err != nullptr ? err : fn(floats);
+  }
+  Ints ints;
+  std::shared_ptr<Object> err = ToInts(args[0], name, &ints);
+  return err != nullptr ? err : fn(ints);
+}
+
+template <typename Vector, typename Op>
+std::shared_ptr<Object> ElementwiseOf(const std::vector<std::shared_ptr<Object>>& args, const std::string& name,
+                                      const Vector& lhs, Op op) {
+  using T = typename Vector::value_type;
+  Vector ret = Vector::Uninitialized(lhs.size());
+  Number scalar;
+  if (UnboxNumber(args[1].get(), &scalar)) {
+    T rhs = scalar.is_float ? static_cast<T>(scalar.f) : static_cast<T>(scalar.i);
+    BroadcastKernel(lhs.data(), rhs, ret.MutableData(), lhs.size(), op);
+    return std::make_shared<ArrayObject>(ret);
+  }
+  Vector rhs;
+  std::shared_ptr<Object> err = Unbox(args[1], name, &rhs);
+  if (err != nullptr) {
+    return err;
+  }
+  if (lhs.size() != rhs.size()) {
+    return std::make_shared<ErrorObject>("arguments to " + name + " differ in length: " +
+                                         std::to_string(lhs.size()) + " and " + std::to_string(rhs.size()));
+  }
+  ElementwiseKernel(lhs.data(), rhs.data(), ret.MutableData(), lhs.size(), op);
+  return std::make_shared<ArrayObject>(ret);
+}
+
+// Elementwise op between two arrays of equal length, or an array and a
+// number.
+template <typename Op>
+std::shared_ptr<Object> Elementwise(const std::vector<std::shared_ptr<Object>>& args, const std::string& name, Op op) {
+  if (args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (HasFloats(args[0]) || HasFloats(args[1])) {
+    Floats lhs;
+    std::shared_ptr<Object> err = ToFloats(args[0], name, &lhs);
+    return err != nullptr ? err : ElementwiseOf(args, name, lhs, op);
+  }
+  Ints lhs;
+  std::shared_ptr<Object> err = ToInts(args[0], name, &lhs);
+  return err != nullptr ? err : ElementwiseOf(args, name, lhs, op);
+}
+
+template <typename Vector>
+std::shared_ptr<Object> DotOf(const Vector& lhs, const Vector& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return std::make_shared<ErrorObject>("arguments to dot differ in length: " +
+                                         std::to_string(lhs.size()) + " and " + std::to_string(rhs.size()));
+  }
+  return Box(DotKernel(lhs.data(), rhs.data(), lhs.size()));
+}
+
+}  // namespace
+
+std::shared_ptr<Object> BuiltInSum(std::vector<std::shared_ptr<Object>> args) {
+  return Reduce(args, "sum", true, [](const auto& v) { return Box(SumKernel(v.data(), v.size())); });
+}
+
+std::shared_ptr<Object> BuiltInMin(std::vector<std::shared_ptr<Object>> args) {
+  return Reduce(args, "min", false, [](const auto& v) { return Box(MinKernel(v.data(), v.size())); });
+}
+
+std::shared_ptr<Object> BuiltInMax(std::vector<std::shared_ptr<Object>> args) {
+  return Reduce(args, "max", false, [](const auto& v) { return Box(MaxKernel(v.data(), v.size())); });
+}
+
+std::shared_ptr<Object> BuiltInDot(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (HasFloats(args[0]) || HasFloats(args[1])) {
+    Floats lhs, rhs;
+    std::shared_ptr<Object> err = ToFloats(args[0], "dot", &lhs);
+    if (err == nullptr) {
+      err = ToFloats(args[1], "dot", &rhs);
+    }
+    return err != nullptr ? err : DotOf(lhs, rhs);
+  }
+  Ints lhs, rhs;
+  std::shared_ptr<Object> err = ToInts(args[0], "dot", &lhs);
+  if (err == nullptr) {
+    err = ToInts(args[1], "dot", &rhs);
+  }
+  return err != nullptr ? err : DotOf(lhs, rhs);
+}
+
+std::shared_ptr<Object> BuiltInAdd(std::vector<std::shared_ptr<Object>> args) {
+  return Elementwise(args, "add", [](auto lhs, auto rhs) { return lhs + rhs; });
+}
+
+std::shared_ptr<Object> BuiltInMul(std::vector<std::shared_ptr<Object>> args) {
+  return Elementwise(args, "mul", [](auto lhs, auto rhs) { return lhs * rhs; });
+}
+
+namespace {
+
+// Bottom-up merge sort. Unlike std::sort it stays in bounds whatever the
+// comparator answers, so a script comparator that fails halfway can not
+// corrupt memory; once less reports an error the order is left as is.
+template <typename Less>
+void MergeSort(std::vector<std::shared_ptr<Object>>& items, Less less) {
+  std::vector<std::shared_ptr<Object>> buffer(items.size());
+  for (size_t width = 1; width < items.size(); width *= 2) {
+    for (size_t begin = 0; begin < items.size(); begin += 2 * width) {
+      size_t mid = std::min(begin + width, items.size());
+      size_t end = std::min(begin + 2 * width, items.size());
+      size_t i = begin, j = mid, k = begin;
+      while (i < mid && j < end) {
+        // Take from the right run only if strictly smaller: stable.
+        if (less(items[j], items[i])) {
+          buffer[k++] = std::move(items[j++]);
+        } else {
+          buffer[k++] = std::move(items[i++]);
+        }
+      }
+      while (i < mid) {
+        buffer[k++] = std::move(items[i++]);
+      }
+      while (j < end) {
+        buffer[k++] = std::move(items[j++]);
+      }
+    }
+    items.swap(buffer);
+  }
+}
+
+std::vector<std::shared_ptr<Object>> ToVector(const ArrayObject& arr) {
+  std::vector<std::shared_ptr<Object>> ret;
+  ret.reserve(arr.Size());
+  arr.ForEach([&ret](const std::shared_ptr<Object>& obj) { ret.push_back(obj); });
+  return ret;
+}
+
+std::shared_ptr<ArrayObject> FromVector(std::vector<std::shared_ptr<Object>>&& items) {
+  std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+  for (auto& item : items) {
+    ret->Append(std::move(item));
+  }
+  return ret;
+}
+
+std::shared_ptr<Object> CheckArray(const std::shared_ptr<Object>& obj, const std::string& name) {
+  if (obj->Type() != ObjectType::kArray) {
+    return std::make_shared<ErrorObject>("argument to " + name + " must be Array, got " + ObjectTypeToString(obj->Type()));
+  }
+  return nullptr;
+}
+
+std::shared_ptr<Object> CheckFunction(const std::shared_ptr<Object>& obj, const std::string& name) {
+  if (obj->Type() != ObjectType::kFunction && obj->Type() != ObjectType::kBuiltIn) {
+    return std::make_shared<ErrorObject>("operation of " + name + " must be function, got " + ObjectTypeToString(obj->Type()));
+  }
+  return nullptr;
+}
+
+bool IsError(const std::shared_ptr<Object>& obj) {
+  return obj != nullptr && obj->Type() == ObjectType::kError;
+}
+
+// Position of value in arr, or -1.
+int64_t IndexOf(const ArrayObject& arr, const std::shared_ptr<Object>& value) {
+  if (arr.IsInts()) {
+    if (value->Type() != ObjectType::kInteger) {
+      return -1;
+    }
+    const int64_t* data = arr.ints.data();
+    const int64_t* found = std::find(data, data + arr.Size(), static_cast<IntegerObject*>(value.get())->value);
+    return found == data + arr.Size() ? -1 : found - data;
+  }
+  if (arr.IsFloats()) {
+    if (value->Type() != ObjectType::kFloat) {
+      return -1;
+    }
+    const double* data = arr.floats.data();
+    const double* found = std::find(data, data + arr.Size(), static_cast<FloatObject*>(value.get())->value);
+    return found == data + arr.Size() ? -1 : found - data;
+  }
+  for (size_t i = 0; i < arr.Size(); ++i) {
+    if (ObjectsEqual(arr.At(i).get(), value.get())) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+
+// sort(arr) orders numbers or strings ascending; sort(arr, less) orders
+// anything by a function returning whether its first argument goes first.
+std::shared_ptr<Object> BuiltInSort(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 1 && args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<Object> err = CheckArray(args[0], "sort");
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> arr = std::static_pointer_cast<ArrayObject>(args[0]);
+  if (args.size() == 2) {
+    err = CheckFunction(args[1], "sort");
+    if (err != nullptr) {
+      return err;
+    }
+    std::vector<std::shared_ptr<Object>> items = ToVector(*arr);
+    MergeSort(items, [&](const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs) {
+      if (err != nullptr) {
+        return false;
+      }
+      std::shared_ptr<Object> ret = ApplyFunction(args[1], {lhs, rhs});
+      if (IsError(ret)) {
+        err = ret;
+        return false;
+      }
+      return ret != nullptr && IsTruthy(ret);
+    });
+    if (err != nullptr) {
+      return err;
+    }
+    return FromVector(std::move(items));
+  }
+
+  if (arr->IsFloats()) {
+    Floats ret = Floats::Uninitialized(arr->Size());
+    double* data = ret.MutableData();
+    std::copy(arr->floats.data(), arr->floats.data() + arr->Size(), data);
+    // NaNs are unordered; they go last so std::sort sees a strict weak order.
+    double* nans = std::partition(data, data + ret.size(), [](double x) { return !std::isnan(x); });
+    std::sort(data, nans);
+    return std::make_shared<ArrayObject>(ret);
+  }
+  bool all_strings = arr->IsGeneric() && arr->Size() > 0;
+  bool all_numbers = arr->IsGeneric();
+  arr->ForEach([&all_strings, &all_numbers](const std::shared_ptr<Object>& obj) {
+    all_strings = all_strings && obj->Type() == ObjectType::kString;
+    all_numbers = all_numbers && (obj->Type() == ObjectType::kInteger || obj->Type() == ObjectType::kFloat);
+  });
+  if (all_strings) {
+    std::vector<std::shared_ptr<Object>> items = ToVector(*arr);
+    MergeSort(items, [](const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs) {
+      return static_cast<StringObject*>(lhs.get())->View() < static_cast<StringObject*>(rhs.get())->View();
+    });
+    return FromVector(std::move(items));
+  }
+  if (all_numbers) {
+    // Mixed integers and floats keep their types.
+    std::vector<std::shared_ptr<Object>> items = ToVector(*arr);
+    MergeSort(items, [](const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs) {
+      Number l{}, r{};
+      UnboxNumber(lhs.get(), &l);
+      UnboxNumber(rhs.get(), &r);
+      return l.is_float || r.is_float ? l.AsDouble() < r.AsDouble() : l.i < r.i;
+    });
+    return FromVector(std::move(items));
+  }
+  Ints ints;
+  err = ToInts(args[0], "sort", &ints);
+  if (err != nullptr) {
+    return err;
+  }
+  Ints ret = Ints::Uninitialized(ints.size());
+  std::copy(ints.data(), ints.data() + ints.size(), ret.MutableData());
+  std::sort(ret.MutableData(), ret.MutableData() + ret.size());
+  return std::make_shared<ArrayObject>(ret);
+}
+
+std::shared_ptr<Object> BuiltInReduce(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 3) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<Object> err = CheckFunction(args[2], "reduce");
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<Object> acc = args[1];
+  if (args[0]->Type() == ObjectType::kSequence) {
+    // Consumes the sequence element by element, in constant memory.
+    err = static_cast<SequenceObject*>(args[0].get())->Run([&](std::shared_ptr<Object> value) {
+      acc = ApplyFunction(args[2], {acc, std::move(value)});
+      return !IsError(acc);
+    });
+    return err != nullptr ? err : acc;
+  }
+  err = CheckArray(args[0], "reduce");
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> arr = std::static_pointer_cast<ArrayObject>(args[0]);
+  for (size_t i = 0; i < arr->Size(); ++i) {
+    acc = ApplyFunction(args[2], {acc, arr->At(i)});
+    if (IsError(acc)) {
+      return acc;
+    }
+  }
+  return acc;
+}
+
+std::shared_ptr<Object> BuiltInFilter(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<Object> err = CheckArray(args[0], "filter");
+  if (err == nullptr) {
+    err = CheckFunction(args[1], "filter");
+  }
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> arr = std::static_pointer_cast<ArrayObject>(args[0]);
+  std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+  for (size_t i = 0; i < arr->Size(); ++i) {
+    std::shared_ptr<Object> elem = arr->At(i);
+    std::shared_ptr<Object> keep = ApplyFunction(args[1], {elem});
+    if (IsError(keep)) {
+      return keep;
+    }
+    if (keep != nullptr && IsTruthy(keep)) {
+      ret->Append(std::move(elem));
+    }
+  }
+  return ret;
+}
+
+// The most elements range builds, 2GB of integers.
+static const uint64_t kMaxRangeLength = uint64_t(1) << 28;
+
+// range(end), range(begin, end) or range(begin, end, step).
+std::shared_ptr<Object> BuiltInRange(std::vector<std::shared_ptr<Object>> args) {
+  if (args.empty() || args.size() > 3) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  int64_t bounds[3] = {0, 0, 1};
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i]->Type() != ObjectType::kInteger) {
+      return std::make_shared<ErrorObject>("arguments to range must be Integer, got " + ObjectTypeToString(args[i]->Type()));
+    }
+    bounds[args.size() == 1 ? 1 : i] = static_cast<IntegerObject*>(args[i].get())->value;
+  }
+  int64_t begin = bounds[0], end = bounds[1], step = bounds[2];
+  if (step == 0) {
+    return std::make_shared<ErrorObject>("step of range must not be 0");
+  }
+  // Distances between int64s only fit in unsigned arithmetic, which also
+  // wraps elements back into range.
+  uint64_t n = 0;
+  if (step > 0 && end > begin) {
+    n = (static_cast<uint64_t>(end) - static_cast<uint64_t>(begin) - 1) / static_cast<uint64_t>(step) + 1;
+  } else if (step < 0 && end < begin) {
+    n = (static_cast<uint64_t>(begin) - static_cast<uint64_t>(end) - 1) / (0 - static_cast<uint64_t>(step)) + 1;
+  }
+  if (n > kMaxRangeLength) {
+    return std::make_shared<ErrorObject>("range of " + std::to_string(n) + " elements exceeds the maximum of " +
+                                         std::to_string(kMaxRangeLength));
+  }
+  Ints ret = Ints::Uninitialized(n);
+  int64_t* data = ret.MutableData();
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = static_cast<int64_t>(static_cast<uint64_t>(begin) + i * static_cast<uint64_t>(step));
+  }
+  return std::make_shared<ArrayObject>(ret);
+}
+
+std::shared_ptr<Object> BuiltInReverse(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 1) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<Object> err = CheckArray(args[0], "reverse");
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> arr = std::static_pointer_cast<ArrayObject>(args[0]);
+  if (arr->IsInts()) {
+    Ints ret = Ints::Uninitialized(arr->Size());
+    std::reverse_copy(arr->ints.data(), arr->ints.data() + arr->Size(), ret.MutableData());
+    return std::make_shared<ArrayObject>(ret);
+  }
+  if (arr->IsFloats()) {
+    Floats ret = Floats::Uninitialized(arr->Size());
+    std::reverse_copy(arr->floats.data(), arr->floats.data() + arr->Size(), ret.MutableData());
+    return std::make_shared<ArrayObject>(ret);
+  }
+  std::vector<std::shared_ptr<Object>> items = ToVector(*arr);
+  std::reverse(items.begin(), items.end());
+  return FromVector(std::move(items));
+}
+
+// contains(arr, value) tests for an element, contains(hash, key) for a key.
+std::shared_ptr<Object> BuiltInContains(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (args[0]->Type() == ObjectType::kHash) {
+    return std::make_shared<BooleanObject>(
+        static_cast<HashObject*>(args[0].get())->table.Find(args[1]) != nullptr);
+  }
+  std::shared_ptr<Object> err = CheckArray(args[0], "contains");
+  if (err != nullptr) {
+    return err;
+  }
+  return std::make_shared<BooleanObject>(IndexOf(*static_cast<ArrayObject*>(args[0].get()), args[1]) >= 0);
+}
+
+std::shared_ptr<Object> BuiltInIndexOf(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<Object> err = CheckArray(args[0], "index_of");
+  if (err != nullptr) {
+    return err;
+  }
+  return std::make_shared<IntegerObject>(IndexOf(*static_cast<ArrayObject*>(args[0].get()), args[1]));
+}
@@ -1,6 +1,8 @@
 #ifndef SRC_AST_H_
 #define SRC_AST_H_
 
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -10,14 +12,26 @@
 #include "lexer/token.h"
 #include "object.h"
 
+#ifdef GOKU_HEATMAP
+#include "heatmap.h"
+// Counts and times the evaluation of the node it is used in, see heatmap.h.
+#define GOKU_HEAT() HeatScope heat_scope(&heat_slot, this, token)
+#else
+#define GOKU_HEAT()
+#endif
+
 class Node {
  public:
   virtual std::string TokenLiteral() = 0;
   virtual std::string String() = 0;
 
-  virtual std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) {
+  virtual std::shared_ptr<Object> Eval(std::shared_ptr<Environment>) {
     return std::make_shared<NullObject>();
   }
+
+#ifdef GOKU_HEATMAP
+  HeatSlot heat_slot;
+#endif
 };
 
 class Statement : public Node {
@@ -25,9 +39,46 @@ class Statement : public Node {
   virtual void statementNode() = 0;
 };
 
+// An unboxed numeric value, so arithmetic on intermediate results does not
+// allocate.
+struct Number {
+  bool is_float;
+  int64_t i;
+  double f;
+
+  double AsDouble() const { return is_float ? f : static_cast<double>(i); }
+};
+
+inline bool UnboxNumber(Object* obj, Number* out) {
+  if (obj->Type() == ObjectType::kInteger) {
+    *out = {false, static_cast<IntegerObject*>(obj)->value, 0};
+    return true;
+  }
+  if (obj->Type() == ObjectType::kFloat) {
+    *out = {true, 0, static_cast<FloatObject*>(obj)->value};
+    return true;
+  }
+  return false;
+}
+
+inline std::shared_ptr<Object> BoxNumber(const Number& n) {
+  if (n.is_float) {
+    return std::make_shared<FloatObject>(n.f);
+  }
+  return std::make_shared<IntegerObject>(n.i);
+}
+
 class Expression : public Node {
  public:
   virtual void expressionNode() = 0;
+
+  // Evaluates to an unboxed number when the value is numeric. Otherwise sets
+  // *boxed to the value, or the error, and returns false. Numeric nodes
+  // override this, so nested arithmetic boxes only its final result.
+  virtual bool EvalNumber(const std::shared_ptr<Environment>& env, Number* out, std::shared_ptr<Object>* boxed) {
+    *boxed = Eval(env);
+    return *boxed != nullptr && UnboxNumber(boxed->get(), out);
+  }
 };
 
 class Program : public Node {
@@ -49,22 +100,60 @@ class Program : public Node {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    return Eval(env, nullptr);
+  }
+
+  // Calls each, if set, with every top-level statement's value.
+  std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env,
+                               const std::function<void(const std::shared_ptr<Object>&)>& each) {
+    if (ObjectStatsEnabled()) {
+      CountEvaluation();
+    }
     std::shared_ptr<Object> ret;
     for (auto stmt : statements) {
-      ret = stmt->Eval(env);
+      try {
+        ret = stmt->Eval(env);
+      } catch (const std::bad_alloc&) {
+        // Failed outside any function call, which would have caught it.
+        ret = std::make_shared<ErrorObject>("out of memory");
+      }
+      if (ObjectStatsEnabled()) {
+        ObjectStatsSafePoint();
+      }
+      // Top-level statement boundaries are the collector's safe points.
+      Heap* heap = Heap::Current();
+      if (heap != nullptr && !heap->MaybeCollect({env}, {ret})) {
+        return std::make_shared<ErrorObject>(
+            "heap limit exceeded: " + std::to_string(heap->stats().live_environments) +
+            " live environments");
+      }
+      Budget* budget = Budget::Current();
+      if (budget != nullptr && budget->Exhausted()) {
+        return std::make_shared<ErrorObject>(budget->Error());
+      }
       if (ret == nullptr) {
         continue;
       }
       if (ret->Type() == ObjectType::kReturnValue) {
-        return std::dynamic_pointer_cast<ReturnValueObject>(ret)->value;
+        ret = std::dynamic_pointer_cast<ReturnValueObject>(ret)->value;
+        if (each && ret != nullptr) {
+          each(ret);
+        }
+        return ret;
       } else if (ret->Type() == ObjectType::kError) {
         return ret;
       }
+      if (each) {
+        each(ret);
+      }
     }
     return ret;
   }
 
   std::vector<std::shared_ptr<Statement>> statements;
+  // The symbol of every identifier in the program, so hosts binding inputs
+  // by name need not intern them on each call.
+  std::unordered_map<std::string, Symbol> names;
 };
 
 class Identifier : public Expression {
@@ -80,20 +169,23 @@ class Identifier : public Expression {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
-    std::shared_ptr<Object> ret = env->Get(value);
+    GOKU_HEAT();
+    std::shared_ptr<Object> ret = env->Get(symbol);
     if (ret == nullptr) {
-      auto iter = BuiltInTable.find(value);
-      if (iter == BuiltInTable.end()) {
-        return std::make_shared<ErrorObject>("identifier not found: " + value);
-      } else {
-        return std::make_shared<BuiltInObject>(iter->second);
+      if (builtin != nullptr) {
+        return builtin;
       }
+      return std::make_shared<ErrorObject>("identifier not found: " + value);
     }
     return ret;
   }
 
   Token token;
   std::string value;
+  Symbol symbol;
+  // Resolved by the parser when the name is a builtin; bindings in the
+  // environment still shadow it.
+  std::shared_ptr<BuiltInObject> builtin;
 };
 
 class IntegerLiteral : public Expression {
@@ -108,14 +200,48 @@ class IntegerLiteral : public Expression {
     return token.literal;
   }
 
-  std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+  std::shared_ptr<Object> Eval(std::shared_ptr<Environment>) override {
+    GOKU_HEAT();
     return std::make_shared<IntegerObject>(value);
   }
 
+  bool EvalNumber(const std::shared_ptr<Environment>&, Number* out, std::shared_ptr<Object>*) override {
+    GOKU_HEAT();
+    *out = {false, value, 0};
+    return true;
+  }
+
   Token token;
   int64_t value;
 };
 
+class FloatLiteral : public Expression {
+ public:
+  std::string TokenLiteral() override {
+    return token.literal;
+  }
+
+  void expressionNode() override {}
+
+  std::string String() override {
+    return token.literal;
+  }
+
+  std::shared_ptr<Object> Eval(std::shared_ptr<Environment>) override {
+    GOKU_HEAT();
+    return std::make_shared<FloatObject>(value);
+  }
+
+  bool EvalNumber(const std::shared_ptr<Environment>&, Number* out, std::shared_ptr<Object>*) override {
+    GOKU_HEAT();
+    *out = {true, 0, value};
+    return true;
+  }
+
+  Token token;
+  double value;
+};
+
 class StringLiteral : public Expression {
  public:
   std::string TokenLiteral() override {
@@ -128,12 +254,14 @@ class StringLiteral : public Expression {
     return token.literal;
   }
 
-  std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
-    return std::make_shared<StringObject>(value);
+  std::shared_ptr<Object> Eval(std::shared_ptr<Environment>) override {
+    GOKU_HEAT();
+    return object;
   }
 
   Token token;
   std::string value;
+  std::shared_ptr<StringObject> object;
 };
 
 class Boolean : public Expression {
@@ -148,7 +276,8 @@ class Boolean : public Expression {
     return token.literal;
   }
 
-  std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+  std::shared_ptr<Object> Eval(std::shared_ptr<Environment>) override {
+    GOKU_HEAT();
     return std::make_shared<BooleanObject>(value);
   }
 
@@ -174,21 +303,25 @@ class PrefixExpression : public Expression {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<Object> evaluated_right = right->Eval(env);
     if (evaluated_right != nullptr && evaluated_right->Type() == ObjectType::kError) {
       return evaluated_right;
     }
+    // Operands may be bound to names or shared with other threads, so the
+    // result is always a new object.
     if (op == "-") {
-      if (evaluated_right->Type() == ObjectType::kInteger) {
-        auto casted_right = std::dynamic_pointer_cast<IntegerObject>(evaluated_right);
-        casted_right->value = -casted_right->value;
-        return casted_right;
+      Number n;
+      if (UnboxNumber(evaluated_right.get(), &n)) {
+        if (!negate(&n)) {
+          return std::make_shared<ErrorObject>("integer overflow in negation");
+        }
+        return BoxNumber(n);
       }
     } else if (op == "!") {
       if (evaluated_right->Type() == ObjectType::kBoolean) {
-        auto casted_right = std::dynamic_pointer_cast<BooleanObject>(evaluated_right);
-        casted_right->value = !casted_right->value;
-        return casted_right;
+        auto casted_right = std::static_pointer_cast<BooleanObject>(evaluated_right);
+        return std::make_shared<BooleanObject>(!casted_right->value);
       } else {
         return std::make_shared<BooleanObject>(false);
       }
@@ -196,9 +329,38 @@ class PrefixExpression : public Expression {
     return std::make_shared<ErrorObject>("unknown operator: " + op + " " + ObjectTypeToString(evaluated_right->Type()));
   }
 
+  bool EvalNumber(const std::shared_ptr<Environment>& env, Number* out, std::shared_ptr<Object>* boxed) override {
+    if (op != "-") {
+      return Expression::EvalNumber(env, out, boxed);
+    }
+    GOKU_HEAT();
+    if (right->EvalNumber(env, out, boxed)) {
+      if (!negate(out)) {
+        *boxed = std::make_shared<ErrorObject>("integer overflow in negation");
+        return false;
+      }
+      return true;
+    }
+    if (*boxed == nullptr || (*boxed)->Type() != ObjectType::kError) {
+      ObjectType type = *boxed == nullptr ? ObjectType::kNull : (*boxed)->Type();
+      *boxed = std::make_shared<ErrorObject>("unknown operator: - " + ObjectTypeToString(type));
+    }
+    return false;
+  }
+
   Token token;
   std::string op;
   std::shared_ptr<Expression> right;
+
+ private:
+  // Returns false if n is the one integer without a negation.
+  static bool negate(Number* n) {
+    if (!n->is_float) {
+      return !__builtin_sub_overflow(int64_t(0), n->i, &n->i);
+    }
+    n->f = -n->f;
+    return true;
+  }
 };
 
 class InfixExpression : public Expression {
@@ -221,43 +383,147 @@ class InfixExpression : public Expression {
     return ret;
   }
 
+  // Numbers take the unboxed path: integers combine to integers, and an
+  // integer meeting a float is promoted to float. Everything else falls
+  // back to evalObjects.
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
-    std::shared_ptr<Object> evaluated_left = left->Eval(env);
-    if (evaluated_left != nullptr && evaluated_left->Type() == ObjectType::kError) {
+    GOKU_HEAT();
+    Number lhs, rhs;
+    std::shared_ptr<Object> evaluated_left, evaluated_right;
+    bool numbers;
+    if (!evalOperands(env, &lhs, &rhs, &evaluated_left, &evaluated_right, &numbers)) {
       return evaluated_left;
     }
-    std::shared_ptr<Object> evaluated_right = right->Eval(env);
-    if (evaluated_right != nullptr && evaluated_right->Type() == ObjectType::kError) {
-      return evaluated_right;
+    if (!numbers) {
+      return evalObjects(evaluated_left, evaluated_right);
     }
-    if (evaluated_left->Type() == ObjectType::kInteger && evaluated_right->Type() == ObjectType::kInteger) {
-      int64_t left_value =
-          std::dynamic_pointer_cast<IntegerObject>(evaluated_left)->value;
-      int64_t right_value =
-          std::dynamic_pointer_cast<IntegerObject>(evaluated_right)->value;
-      if (op == "+") {
-        return std::make_shared<IntegerObject>(left_value + right_value);
-      } else if (op == "-") {
-        return std::make_shared<IntegerObject>(left_value - right_value);
-      } else if (op == "*") {
-        return std::make_shared<IntegerObject>(left_value * right_value);
-      } else if (op == "/") {
-        return std::make_shared<IntegerObject>(left_value / right_value);
-      } else if (op == "<") {
-        return std::make_shared<BooleanObject>(left_value < right_value);
-      } else if (op == ">") {
-        return std::make_shared<BooleanObject>(left_value > right_value);
-      } else if (op == "==") {
-        return std::make_shared<BooleanObject>(left_value == right_value);
-      } else if (op == "!=") {
-        return std::make_shared<BooleanObject>(left_value != right_value);
-      } else {
-        return std::make_shared<ErrorObject>("unknown operator " + op +
-                                             " between integers");
+    switch (token.type) {
+    case TokenType::kLT:
+      return std::make_shared<BooleanObject>(lhs.is_float || rhs.is_float ? lhs.AsDouble() < rhs.AsDouble() : lhs.i < rhs.i);
+    case TokenType::kGT:
+      return std::make_shared<BooleanObject>(lhs.is_float || rhs.is_float ? lhs.AsDouble() > rhs.AsDouble() : lhs.i > rhs.i);
+    case TokenType::kEQ:
+      return std::make_shared<BooleanObject>(lhs.is_float || rhs.is_float ? lhs.AsDouble() == rhs.AsDouble() : lhs.i == rhs.i);
+    case TokenType::kNEQ:
+      return std::make_shared<BooleanObject>(lhs.is_float || rhs.is_float ? lhs.AsDouble() != rhs.AsDouble() : lhs.i != rhs.i);
+    default: {
+      Number ret;
+      std::shared_ptr<Object> err;
+      if (!arithmetic(lhs, rhs, &ret, &err)) {
+        return err;
+      }
+      return BoxNumber(ret);
+    }
+    }
+  }
+
+  bool EvalNumber(const std::shared_ptr<Environment>& env, Number* out, std::shared_ptr<Object>* boxed) override {
+    if (!isArithmetic()) {
+      return Expression::EvalNumber(env, out, boxed);
+    }
+    GOKU_HEAT();
+    Number lhs, rhs;
+    std::shared_ptr<Object> evaluated_left, evaluated_right;
+    bool numbers;
+    if (!evalOperands(env, &lhs, &rhs, &evaluated_left, &evaluated_right, &numbers)) {
+      *boxed = evaluated_left;
+      return false;
+    }
+    if (!numbers) {
+      *boxed = evalObjects(evaluated_left, evaluated_right);
+      return false;
+    }
+    return arithmetic(lhs, rhs, out, boxed);
+  }
+
+  Token token;
+  std::shared_ptr<Expression> left;
+  std::string op;
+  std::shared_ptr<Expression> right;
+
+ private:
+  bool isArithmetic() const {
+    return token.type == TokenType::kPlus || token.type == TokenType::kMinus ||
+           token.type == TokenType::kAsterisk || token.type == TokenType::kSlash;
+  }
+
+  // Evaluates both operands. If both are numbers, fills lhs and rhs;
+  // otherwise fills both objects, boxing a numeric operand if needed.
+  // Returns false with the error in *left_obj if an operand failed.
+  bool evalOperands(const std::shared_ptr<Environment>& env, Number* lhs, Number* rhs,
+                    std::shared_ptr<Object>* left_obj, std::shared_ptr<Object>* right_obj, bool* numbers) {
+    bool left_number = left->EvalNumber(env, lhs, left_obj);
+    if (!left_number && *left_obj != nullptr && (*left_obj)->Type() == ObjectType::kError) {
+      return false;
+    }
+    bool right_number = right->EvalNumber(env, rhs, right_obj);
+    if (!right_number && *right_obj != nullptr && (*right_obj)->Type() == ObjectType::kError) {
+      *left_obj = std::move(*right_obj);
+      return false;
+    }
+    *numbers = left_number && right_number;
+    if (!*numbers) {
+      if (*left_obj == nullptr) {
+        *left_obj = left_number ? BoxNumber(*lhs) : std::make_shared<NullObject>();
+      }
+      if (*right_obj == nullptr) {
+        *right_obj = right_number ? BoxNumber(*rhs) : std::make_shared<NullObject>();
       }
-    } else if (evaluated_left->Type() == ObjectType::kString && evaluated_right->Type() == ObjectType::kString && op == "+") {
-      return std::make_shared<StringObject>(std::dynamic_pointer_cast<StringObject>(evaluated_left)->value
-                                            + std::dynamic_pointer_cast<StringObject>(evaluated_right)->value);
+    }
+    return true;
+  }
+
+  bool arithmetic(const Number& lhs, const Number& rhs, Number* out, std::shared_ptr<Object>* err) const {
+    if (!lhs.is_float && !rhs.is_float) {
+      out->is_float = false;
+      switch (token.type) {
+      case TokenType::kPlus:
+        if (__builtin_add_overflow(lhs.i, rhs.i, &out->i)) {
+          *err = std::make_shared<ErrorObject>("integer overflow in addition");
+          return false;
+        }
+        return true;
+      case TokenType::kMinus:
+        if (__builtin_sub_overflow(lhs.i, rhs.i, &out->i)) {
+          *err = std::make_shared<ErrorObject>("integer overflow in subtraction");
+          return false;
+        }
+        return true;
+      case TokenType::kAsterisk:
+        if (__builtin_mul_overflow(lhs.i, rhs.i, &out->i)) {
+          *err = std::make_shared<ErrorObject>("integer overflow in multiplication");
+          return false;
+        }
+        return true;
+      default:
+        if (rhs.i == 0) {
+          *err = std::make_shared<ErrorObject>("division by zero");
+          return false;
+        }
+        if (rhs.i == -1 && lhs.i == std::numeric_limits<int64_t>::min()) {
+          *err = std::make_shared<ErrorObject>("integer overflow in division");
+          return false;
+        }
+        out->i = lhs.i / rhs.i;
+        return true;
+      }
+    }
+    double l = lhs.AsDouble();
+    double r = rhs.AsDouble();
+    out->is_float = true;
+    switch (token.type) {
+    case TokenType::kPlus: out->f = l + r; return true;
+    case TokenType::kMinus: out->f = l - r; return true;
+    case TokenType::kAsterisk: out->f = l * r; return true;
+    default: out->f = l / r; return true;
+    }
+  }
+
+  std::shared_ptr<Object> evalObjects(const std::shared_ptr<Object>& evaluated_left,
+                                      const std::shared_ptr<Object>& evaluated_right) const {
+    if (evaluated_left->Type() == ObjectType::kString && evaluated_right->Type() == ObjectType::kString && op == "+") {
+      return ConcatStrings(std::static_pointer_cast<StringObject>(evaluated_left),
+                           std::static_pointer_cast<StringObject>(evaluated_right));
     } else if (op == "==") {
       return std::make_shared<BooleanObject>(ObjectEqual()(evaluated_left, evaluated_right));
     } else if (op == "!=") {
@@ -269,11 +535,6 @@ class InfixExpression : public Expression {
                                            + ObjectTypeToString(evaluated_right->Type()));
     }
   }
-
-  Token token;
-  std::shared_ptr<Expression> left;
-  std::string op;
-  std::shared_ptr<Expression> right;
 };
 
 class LetStatement : public Statement {
@@ -298,11 +559,12 @@ class LetStatement : public Statement {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<Object> evaluated_value = value->Eval(env);
     if (evaluated_value != nullptr && evaluated_value->Type() == ObjectType::kError) {
       return evaluated_value;
     }
-    env->Set(name->value, evaluated_value);
+    env->Set(name->symbol, evaluated_value);
     return nullptr;
   }
 
@@ -331,6 +593,7 @@ class ReturnStatement : public Statement {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<Object> ret = ret_value->Eval(env);
     if (ret != nullptr && ret->Type() == ObjectType::kError) {
       return ret;
@@ -358,6 +621,7 @@ class ExpressionStatement : public Statement {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     return expression->Eval(env);
   }
 
@@ -385,6 +649,7 @@ class BlockStatement : public Statement {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<Object> ret;
     for (auto stmt : statements_) {
       ret = stmt->Eval(env);
@@ -421,6 +686,7 @@ class IfExpression : public Expression {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<Object> evaluated_condition = condition->Eval(env);
     if (evaluated_condition != nullptr && evaluated_condition->Type() == ObjectType::kError) {
       return evaluated_condition;
@@ -461,12 +727,15 @@ class FunctionLiteral : public Expression {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
-    return std::make_shared<FunctionObject>(parameters, body, env);
+    GOKU_HEAT();
+    return std::make_shared<FunctionObject>(parameters, body, env, name);
   }
 
   Token token;
   std::vector<Identifier> parameters;
   std::shared_ptr<BlockStatement> body;
+  // The let binding the literal is the value of, if any.
+  Symbol name;
 };
 
 class CallExpression : public Expression {
@@ -489,6 +758,7 @@ class CallExpression : public Expression {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<Object> evaluated_function = function->Eval(env);
     if (evaluated_function != nullptr && evaluated_function->Type() == ObjectType::kError) {
       return evaluated_function;
@@ -496,45 +766,20 @@ class CallExpression : public Expression {
     if (evaluated_function == nullptr) {
       return std::make_shared<ErrorObject>("function is null");
     }
-    if (evaluated_function->Type() == ObjectType::kFunction) {
-      std::shared_ptr<FunctionObject> casted_function =
-          std::dynamic_pointer_cast<FunctionObject>(evaluated_function);
-      std::vector<std::shared_ptr<Object>> args;
-      for (auto exp : arguments) {
-        std::shared_ptr<Object> evaluated = exp->Eval(env);
-        if (evaluated != nullptr && evaluated->Type() == ObjectType::kError) {
-          return evaluated;
-        }
-        args.push_back(evaluated);
-      }
-
-      std::shared_ptr<Environment> nested_env =
-          std::make_shared<Environment>(casted_function->env);
-      int paramNum = casted_function->parameters.size();
-      for (int i = 0; i < paramNum; ++i) {
-        nested_env->Set(casted_function->parameters[i].value, args[i]);
-      }
-      std::shared_ptr<Object> ret = casted_function->body->Eval(nested_env);
-      if (ret != nullptr && ret->Type() == ObjectType::kReturnValue) {
-        return std::dynamic_pointer_cast<ReturnValueObject>(ret)->value;
-      } else {
-        return ret;
-      }
-    } else if (evaluated_function->Type() == ObjectType::kBuiltIn) {
-      std::shared_ptr<BuiltInObject> casted_function =
-          std::dynamic_pointer_cast<BuiltInObject>(evaluated_function);
-      std::vector<std::shared_ptr<Object>> args;
-      for (auto exp : arguments) {
-        std::shared_ptr<Object> evaluated = exp->Eval(env);
-        if (evaluated != nullptr && evaluated->Type() == ObjectType::kError) {
-          return evaluated;
-        }
-        args.push_back(evaluated);
-      }
-      return casted_function->fn(args);
-    } else {
+    if (evaluated_function->Type() != ObjectType::kFunction &&
+        evaluated_function->Type() != ObjectType::kBuiltIn) {
       return std::make_shared<ErrorObject>("wrong type in call statement: " + ObjectTypeToString(evaluated_function->Type()));
     }
+    std::vector<std::shared_ptr<Object>> args;
+    args.reserve(arguments.size());
+    for (auto& exp : arguments) {
+      std::shared_ptr<Object> evaluated = exp->Eval(env);
+      if (evaluated != nullptr && evaluated->Type() == ObjectType::kError) {
+        return evaluated;
+      }
+      args.push_back(std::move(evaluated));
+    }
+    return ApplyFunction(evaluated_function, std::move(args));
   }
 
   Token token;
@@ -561,9 +806,10 @@ class ArrayLiteral : public Expression {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<ArrayObject> arr = std::make_shared<ArrayObject>();
     for (auto elem : elements) {
-      arr->objects.push_back(elem->Eval(env));
+      arr->Append(elem->Eval(env));
     }
     return arr;
   }
@@ -589,6 +835,7 @@ class IndexExpression : public Expression {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<Object> evaluated_left = left->Eval(env);
     if (evaluated_left == nullptr || evaluated_left->Type() == ObjectType::kError) {
       return evaluated_left;
@@ -608,23 +855,23 @@ class IndexExpression : public Expression {
       }
       int64_t index =
           std::dynamic_pointer_cast<IntegerObject>(evaluated_right)->value;
-      if (index >= casted_left->objects.size()) {
+      if (index < 0 || index >= static_cast<int64_t>(casted_left->Size())) {
         return std::make_shared<ErrorObject>(
             "index(" + std::to_string(index) + ") exceeds array size(" +
-            std::to_string(casted_left->objects.size()) + ")");
+            std::to_string(casted_left->Size()) + ")");
       }
-      return casted_left->objects[index];
+      return casted_left->At(index);
     } else if (evaluated_left->Type() == ObjectType::kHash) {
       std::shared_ptr<HashObject> casted_left = std::dynamic_pointer_cast<HashObject>(evaluated_left);
       std::shared_ptr<Object> evaluated_right = right->Eval(env);
-      if (evaluated_right != nullptr && evaluated_left->Type() == ObjectType::kError) {
+      if (evaluated_right == nullptr || evaluated_right->Type() == ObjectType::kError) {
         return evaluated_right;
       }
-      auto iter = casted_left->table.find(evaluated_right);
-      if (iter == casted_left->table.end()) {
+      std::shared_ptr<Object> value = casted_left->table.Find(evaluated_right);
+      if (value == nullptr) {
         return std::make_shared<NullObject>();
       } else {
-        return iter->second;
+        return value;
       }
     } else {
       return std::make_shared<ErrorObject>
@@ -637,6 +884,83 @@ class IndexExpression : public Expression {
   std::shared_ptr<Expression> right;
 };
 
+class SliceExpression : public Expression {
+ public:
+  std::string TokenLiteral() override {
+    return token.literal;
+  }
+
+  void expressionNode() override {}
+
+  std::string String() override {
+    std::string ret = left->String();
+    ret += "[";
+    if (begin != nullptr) {
+      ret += begin->String();
+    }
+    ret += ":";
+    if (end != nullptr) {
+      ret += end->String();
+    }
+    ret += "]";
+    return ret;
+  }
+
+  std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
+    std::shared_ptr<Object> evaluated_left = left->Eval(env);
+    if (evaluated_left == nullptr || evaluated_left->Type() == ObjectType::kError) {
+      return evaluated_left;
+    }
+    if (evaluated_left->Type() != ObjectType::kArray) {
+      return std::make_shared<ErrorObject>
+          ("slice operator not supported: " + ObjectTypeToString(evaluated_left->Type()));
+    }
+    std::shared_ptr<ArrayObject> casted_left =
+        std::static_pointer_cast<ArrayObject>(evaluated_left);
+    int64_t size = casted_left->Size();
+    int64_t from = 0;
+    int64_t to = size;
+    std::shared_ptr<Object> err = evalBound(begin, env, &from);
+    if (err == nullptr) {
+      err = evalBound(end, env, &to);
+    }
+    if (err != nullptr) {
+      return err;
+    }
+    if (from < 0 || from > to || to > size) {
+      return std::make_shared<ErrorObject>(
+          "slice [" + std::to_string(from) + ":" + std::to_string(to) +
+          "] out of range for array size(" + std::to_string(size) + ")");
+    }
+    return casted_left->Slice(from, to);
+  }
+
+  Token token;
+  std::shared_ptr<Expression> left;
+  // Either bound may be omitted.
+  std::shared_ptr<Expression> begin;
+  std::shared_ptr<Expression> end;
+
+ private:
+  std::shared_ptr<Object> evalBound(const std::shared_ptr<Expression>& bound,
+                                    const std::shared_ptr<Environment>& env, int64_t* out) {
+    if (bound == nullptr) {
+      return nullptr;
+    }
+    std::shared_ptr<Object> evaluated = bound->Eval(env);
+    if (evaluated == nullptr || evaluated->Type() == ObjectType::kError) {
+      return evaluated;
+    }
+    if (evaluated->Type() != ObjectType::kInteger) {
+      return std::make_shared<ErrorObject>(
+          "slice bound should be integer, got " + ObjectTypeToString(evaluated->Type()));
+    }
+    *out = static_cast<IntegerObject*>(evaluated.get())->value;
+    return nullptr;
+  }
+};
+
 class HashLiteral : public Expression {
  public:
   std::string TokenLiteral() override {
@@ -658,7 +982,9 @@ class HashLiteral : public Expression {
   }
 
   std::shared_ptr<Object> Eval(std::shared_ptr<Environment> env) override {
+    GOKU_HEAT();
     std::shared_ptr<HashObject> ret = std::make_shared<HashObject>();
+    ret->table.Reserve(pairs.size());
     for (auto& pair : pairs) {
       std::shared_ptr<Object> key = pair.first->Eval(env);
       if (key != nullptr && key->Type() == ObjectType::kError) {
@@ -668,13 +994,13 @@ class HashLiteral : public Expression {
       if (value != nullptr && value->Type() == ObjectType::kError) {
         return value;
       }
-      ret->table[key] = value;
+      ret->table.Set(key, value);
     }
     return ret;
   }
 
   Token token;
-  std::unordered_map<std::shared_ptr<Expression>, std::shared_ptr<Expression>> pairs;
+  std::vector<std::pair<std::shared_ptr<Expression>, std::shared_ptr<Expression>>> pairs;
 };
 
 #endif  // SRC_AST_H_
\ No newline at end of file
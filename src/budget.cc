@@ -0,0 +1,101 @@
+#include "budget.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+
+namespace {
+
+const size_t kMaxStackReserve = 1 << 20;
+
+// The bounds of the calling thread's stack, which grows down from top.
+bool StackBounds(uintptr_t* top, size_t* size) {
+#if defined(__APPLE__)
+  pthread_t self = pthread_self();
+  *top = reinterpret_cast<uintptr_t>(pthread_get_stackaddr_np(self));
+  *size = pthread_get_stacksize_np(self);
+  return true;
+#elif defined(__linux__)
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+    return false;
+  }
+  void* low;
+  bool ok = pthread_attr_getstack(&attr, &low, size) == 0;
+  pthread_attr_destroy(&attr);
+  *top = reinterpret_cast<uintptr_t>(low) + *size;
+  return ok;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
+uintptr_t StackLimit() {
+  static thread_local uintptr_t limit = 0;
+  if (limit == 0) {
+    uintptr_t top;
+    size_t size;
+    if (StackBounds(&top, &size)) {
+      limit = top - size + std::min(size / 4, kMaxStackReserve);
+    } else {
+      // No limit.
+      limit = 1;
+    }
+  }
+  return limit;
+}
+
+Budget::Budget(const BudgetOptions& options, const std::atomic<bool>* closing)
+    : options_(options), closing_(closing) {
+  if (options_.timeout.count() > 0) {
+    deadline_ = std::chrono::steady_clock::now() + options_.timeout;
+  }
+}
+
+bool Budget::refill() {
+  // Only the current budget's batch is kept; others take one step at a time.
+  uint64_t batch = this == current_ ? kStepBatch : 1;
+  uint64_t steps = steps_.load(std::memory_order_relaxed);
+  do {
+    if (options_.max_steps != 0) {
+      if (steps >= options_.max_steps) {
+        exhaust(kSteps);
+        return false;
+      }
+      batch = std::min(batch, options_.max_steps - steps);
+    }
+  } while (!steps_.compare_exchange_weak(steps, steps + batch, std::memory_order_relaxed));
+  if (cancelled()) {
+    exhaust(kCancelled);
+    return false;
+  }
+  if (deadline_passed()) {
+    exhaust(kDeadline);
+    return false;
+  }
+  if (this == current_) {
+    batch_ = batch - 1;
+  }
+  return true;
+}
+
+bool Budget::deadline_passed() const {
+  return options_.timeout.count() > 0 && std::chrono::steady_clock::now() >= deadline_;
+}
+
+std::string Budget::Error() const {
+  switch (reason_.load(std::memory_order_relaxed)) {
+  case kSteps:
+    return "step budget of " + std::to_string(options_.max_steps) + " calls exceeded";
+  case kMemory:
+    return "memory budget of " + std::to_string(options_.max_bytes) + " bytes exceeded";
+  case kDeadline:
+    return "deadline of " + std::to_string(options_.timeout.count() / 1000000) + "ms exceeded";
+  case kCancelled:
+    return "evaluation cancelled";
+  default:
+    return "";
+  }
+}
@@ -0,0 +1,183 @@
+#ifndef SRC_BUDGET_H_
+#define SRC_BUDGET_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+
+struct BudgetOptions {
+  // Function calls an evaluation may make, 0 means unlimited. Scripts have
+  // no loops, so calls are where every repetition goes through.
+  uint64_t max_steps = 0;
+  // Nested function calls on one thread, 0 means unlimited. Calls fail
+  // before they overflow the thread's stack either way, see StackExhausted.
+  size_t max_depth = 0;
+  // Bytes an evaluation may allocate for environments, string characters
+  // and array and hash storage, whether still live or not. 0 means
+  // unlimited.
+  size_t max_bytes = 0;
+  // Wall-clock time from the start of the evaluation, 0 means unlimited.
+  std::chrono::nanoseconds timeout{0};
+  // Set by any thread to stop the evaluation at its next call, or while
+  // it waits on a channel.
+  const std::atomic<bool>* cancel = nullptr;
+};
+
+// The limits of one evaluation, shared by the tasks and parallel builtins
+// it starts. Function calls count steps and check the limits; small
+// allocations only add up their bytes, which the next call or top-level
+// statement checks. Large blocks, such as array storage, are checked
+// before they are allocated (see ReserveBudget). Once a limit is hit
+// the budget stays exhausted and every further call fails with the same
+// error, so the evaluation unwinds even through builtins that would carry
+// on after an error.
+//
+// Threads take steps from the shared count in batches and only check
+// cancellation and the deadline when they take the next one, so a call
+// costs no atomic read-modify-write and no clock read. Unused steps go
+// back when the thread leaves the budget's scope. With several threads,
+// one may run out of steps while others still hold part of a batch.
+//
+// Budgets must be created with std::make_shared: tasks outliving the
+// evaluation keep theirs alive.
+class Budget : public std::enable_shared_from_this<Budget> {
+ public:
+  // closing, if given, cancels like options.cancel. Owners set it to stop
+  // all their evaluations at once, such as an interpreter being destroyed.
+  explicit Budget(const BudgetOptions& options, const std::atomic<bool>* closing = nullptr);
+
+  Budget(const Budget&) = delete;
+  Budget& operator=(const Budget&) = delete;
+
+  static Budget* Current() { return current_; }
+  static void SetCurrent(Budget* budget) {
+    if (current_ != nullptr && batch_ != 0) {
+      current_->steps_.fetch_sub(batch_, std::memory_order_relaxed);
+      batch_ = 0;
+    }
+    current_ = budget;
+  }
+
+  // Counts a function call. Returns false once the budget is exhausted.
+  bool Step() {
+    if (reason_.load(std::memory_order_relaxed) != kNone) {
+      return false;
+    }
+    if (batch_ != 0 && this == current_) {
+      --batch_;
+      return true;
+    }
+    return refill();
+  }
+
+  // Checks cancellation and the deadline without counting a call, for
+  // threads that wait instead, such as on a channel. Returns false once
+  // the budget is exhausted.
+  bool Check() {
+    if (cancelled()) {
+      exhaust(kCancelled);
+    } else if (deadline_passed()) {
+      exhaust(kDeadline);
+    }
+    return !Exhausted();
+  }
+
+  // Returns false if the bytes exceed the budget.
+  bool Charge(size_t bytes) {
+    if (options_.max_bytes != 0 &&
+        bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes > options_.max_bytes) {
+      exhaust(kMemory);
+      return false;
+    }
+    return true;
+  }
+
+  bool Exhausted() const { return reason_.load(std::memory_order_relaxed) != kNone; }
+
+  // Why the budget is exhausted.
+  std::string Error() const;
+
+  const BudgetOptions& options() const { return options_; }
+  // Including steps threads have taken but not made yet.
+  uint64_t steps() const { return steps_.load(std::memory_order_relaxed); }
+  size_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+ private:
+  enum Reason { kNone, kSteps, kMemory, kDeadline, kCancelled };
+
+  // Steps a thread takes from the shared count at a time. Reading the
+  // clock costs as much as a short call, so it is only done once a batch.
+  static const uint64_t kStepBatch = 1024;
+
+  // Takes the next batch for the calling thread and counts one step of it.
+  bool refill();
+  bool deadline_passed() const;
+  bool cancelled() const {
+    return (options_.cancel != nullptr && options_.cancel->load(std::memory_order_relaxed)) ||
+           (closing_ != nullptr && closing_->load(std::memory_order_relaxed));
+  }
+  void exhaust(Reason reason) {
+    int expected = kNone;
+    reason_.compare_exchange_strong(expected, reason, std::memory_order_relaxed);
+  }
+
+  inline static thread_local Budget* current_ = nullptr;
+  // Steps left of the batch this thread took from current_.
+  inline static thread_local uint64_t batch_ = 0;
+
+  BudgetOptions options_;
+  const std::atomic<bool>* closing_;
+  std::chrono::steady_clock::time_point deadline_;
+  std::atomic<uint64_t> steps_{0};
+  std::atomic<size_t> bytes_{0};
+  std::atomic<int> reason_{kNone};
+};
+
+// The lowest address calls may use on this thread, computed on first use.
+uintptr_t StackLimit();
+
+// Whether the calling thread's stack is nearly full. Function calls check
+// this rather than count, as frame sizes differ between builds and stack
+// sizes between threads. What is left, a quarter of the stack but at most
+// 1MB, covers the builtins and evaluator code that recurse between calls.
+inline bool StackExhausted() {
+  char probe;
+  return reinterpret_cast<uintptr_t>(&probe) < StackLimit();
+}
+
+// Counts bytes against the current budget, if any.
+inline void ChargeBudget(size_t bytes) {
+  Budget* budget = Budget::Current();
+  if (budget != nullptr) {
+    budget->Charge(bytes);
+  }
+}
+
+// Counts a block about to be allocated. If the budget can not cover it,
+// throws std::bad_alloc as a failed allocation would, before anything is
+// allocated. Function calls and top-level statements turn it into an
+// error, see ApplyFunction.
+inline void ReserveBudget(size_t bytes) {
+  Budget* budget = Budget::Current();
+  if (budget != nullptr && !budget->Charge(bytes)) {
+    throw std::bad_alloc();
+  }
+}
+
+// Installs a budget as current for the lifetime of the scope.
+class BudgetScope {
+ public:
+  explicit BudgetScope(Budget* budget) : saved_(Budget::Current()) {
+    Budget::SetCurrent(budget);
+  }
+  ~BudgetScope() { Budget::SetCurrent(saved_); }
+
+ private:
+  Budget* saved_;
+};
+
+#endif  // SRC_BUDGET_H_
@@ -0,0 +1,68 @@
+#ifndef SRC_BUILTINS_H_
+#define SRC_BUILTINS_H_
+
+#include <memory>
+#include <vector>
+
+#include "object.h"
+
+// Builtins implemented outside object.cc; BuiltInTable binds them to names.
+
+// Array builtins, see array_builtins.cc.
+std::shared_ptr<Object> BuiltInSum(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInMin(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInMax(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInDot(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInAdd(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInMul(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInSort(std::vector<std::shared_ptr<Object>> args);
+
+// Native array builtins calling back into scripts through ApplyFunction.
+std::shared_ptr<Object> BuiltInReduce(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInFilter(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInRange(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInReverse(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInContains(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInIndexOf(std::vector<std::shared_ptr<Object>> args);
+
+// Lazy sequence builtins, see sequence_builtins.cc.
+std::shared_ptr<Object> BuiltInIter(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInLazyMap(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInLazyFilter(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInTake(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInCollect(std::vector<std::shared_ptr<Object>> args);
+
+// String builtins, see string_builtins.cc.
+std::shared_ptr<Object> BuiltInSplit(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInJoin(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInFind(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInReplace(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInStartsWith(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInEndsWith(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInTrim(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInUpper(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInLower(std::vector<std::shared_ptr<Object>> args);
+
+// File builtins, see file_builtins.cc.
+std::shared_ptr<Object> BuiltInReadFile(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInLines(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInWriteFile(std::vector<std::shared_ptr<Object>> args);
+
+// JSON builtins, see json_builtins.cc.
+std::shared_ptr<Object> BuiltInJsonParse(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInJsonStringify(std::vector<std::shared_ptr<Object>> args);
+
+// Data-parallel and task builtins, see parallel_builtins.cc.
+std::shared_ptr<Object> BuiltInParallelMap(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInParallelFilter(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInParallelReduce(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInSpawn(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInAwait(std::vector<std::shared_ptr<Object>> args);
+
+// Channel builtins, see channel_builtins.cc.
+std::shared_ptr<Object> BuiltInChannel(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInSend(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInRecv(std::vector<std::shared_ptr<Object>> args);
+std::shared_ptr<Object> BuiltInClose(std::vector<std::shared_ptr<Object>> args);
+
+#endif  // SRC_BUILTINS_H_
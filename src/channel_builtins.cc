@@ -0,0 +1,140 @@
+#include "builtins.h"
+
+#include <string>
+
+#include "ast.h"
+
+// channel, send, recv and close connect producer and consumer stages,
+// whether they are tasks of one interpreter or separate interpreters that
+// the host handed the same channel (see Interpreter::Bind).
+
+namespace {
+
+const size_t kDefaultCapacity = 64;
+
+// A value may be sent if nothing reachable from it can change or refers to
+// an environment, which belongs to the sender's heap. Returns the type that
+// makes obj unsendable, or nullptr.
+const char* Unsendable(Object* obj) {
+  switch (obj->Type()) {
+  case ObjectType::kInteger:
+  case ObjectType::kFloat:
+  case ObjectType::kBoolean:
+  case ObjectType::kNull:
+  case ObjectType::kString:
+  case ObjectType::kError:
+  case ObjectType::kBuiltIn:
+  case ObjectType::kChannel:
+    return nullptr;
+  case ObjectType::kArray: {
+    ArrayObject* arr = static_cast<ArrayObject*>(obj);
+    if (!arr->IsGeneric()) {
+      return nullptr;
+    }
+    const char* ret = nullptr;
+    arr->ForEach([&ret](const std::shared_ptr<Object>& elem) {
+      if (ret == nullptr) {
+        ret = Unsendable(elem.get());
+      }
+    });
+    return ret;
+  }
+  case ObjectType::kHash:
+    for (auto& entry : static_cast<HashObject*>(obj)->table) {
+      const char* ret = Unsendable(entry.key.get());
+      if (ret == nullptr) {
+        ret = Unsendable(entry.value.get());
+      }
+      if (ret != nullptr) {
+        return ret;
+      }
+    }
+    return nullptr;
+  case ObjectType::kFunction:
+    return "Function";
+  case ObjectType::kTask:
+    return "Task";
+  case ObjectType::kSequence:
+    return "Sequence";
+  case ObjectType::kStringBuilder:
+    return "StringBuilder";
+  default:
+    return "Unknown";
+  }
+}
+
+std::shared_ptr<Object> CheckChannel(const std::vector<std::shared_ptr<Object>>& args, const std::string& name,
+                                     size_t want) {
+  if (args.size() != want) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (args[0]->Type() != ObjectType::kChannel) {
+    return std::make_shared<ErrorObject>("argument to " + name + " must be Channel, got " + ObjectTypeToString(args[0]->Type()));
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+// channel() or channel(capacity) makes a channel holding at least capacity
+// values; the capacity is rounded up to a power of two.
+std::shared_ptr<Object> BuiltInChannel(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() > 1) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  size_t capacity = kDefaultCapacity;
+  if (args.size() == 1) {
+    if (args[0]->Type() != ObjectType::kInteger) {
+      return std::make_shared<ErrorObject>("capacity of channel must be Integer, got " + ObjectTypeToString(args[0]->Type()));
+    }
+    int64_t value = static_cast<IntegerObject*>(args[0].get())->value;
+    if (value < 1 || value > (int64_t(1) << 30)) {
+      return std::make_shared<ErrorObject>("capacity of channel must be between 1 and 2^30, got " + std::to_string(value));
+    }
+    capacity = value;
+  }
+  return std::make_shared<ChannelObject>(capacity);
+}
+
+std::shared_ptr<Object> BuiltInSend(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckChannel(args, "send", 2);
+  if (err != nullptr) {
+    return err;
+  }
+  const char* type = Unsendable(args[1].get());
+  if (type != nullptr) {
+    return std::make_shared<ErrorObject>("cannot send " + std::string(type) + " over a channel");
+  }
+  std::string error = static_cast<ChannelObject*>(args[0].get())->Send(args[1]);
+  if (!error.empty()) {
+    return std::make_shared<ErrorObject>(error);
+  }
+  return std::make_shared<NullObject>();
+}
+
+// recv(ch) is the next value, or null once the channel is closed and
+// drained.
+std::shared_ptr<Object> BuiltInRecv(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckChannel(args, "recv", 1);
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<Object> ret;
+  std::string error = static_cast<ChannelObject*>(args[0].get())->Recv(&ret);
+  if (!error.empty()) {
+    return std::make_shared<ErrorObject>(error);
+  }
+  if (ret == nullptr) {
+    return std::make_shared<NullObject>();
+  }
+  return ret;
+}
+
+std::shared_ptr<Object> BuiltInClose(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckChannel(args, "close", 1);
+  if (err != nullptr) {
+    return err;
+  }
+  static_cast<ChannelObject*>(args[0].get())->Close();
+  return std::make_shared<NullObject>();
+}
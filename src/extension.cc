@@ -0,0 +1,172 @@
+#include "extension.h"
+
+#include <dlfcn.h>
+
+#include <map>
+
+#include "ast.h"
+
+namespace {
+
+std::map<std::string, NativeFnType>& Registry() {
+  static std::map<std::string, NativeFnType> registry;
+  return registry;
+}
+
+bool RegisterBuiltIn(const char* name, NativeFnType fn) {
+  if (name == nullptr || fn == nullptr || BuiltInTable.count(name) != 0) {
+    return false;
+  }
+  return Registry().emplace(name, fn).second;
+}
+
+std::shared_ptr<Object> NewInteger(int64_t value) {
+  return std::make_shared<IntegerObject>(value);
+}
+
+std::shared_ptr<Object> NewBoolean(bool value) {
+  return std::make_shared<BooleanObject>(value);
+}
+
+std::shared_ptr<Object> NewNull() {
+  return std::make_shared<NullObject>();
+}
+
+std::shared_ptr<Object> NewString(const char* data, size_t size) {
+  return std::make_shared<StringObject>(std::string(data, size));
+}
+
+std::shared_ptr<Object> NewError(const char* message) {
+  return std::make_shared<ErrorObject>(message);
+}
+
+std::shared_ptr<Object> NewArray(ObjectSpan elements) {
+  std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+  for (auto& elem : elements) {
+    ret->Append(elem);
+  }
+  return ret;
+}
+
+std::shared_ptr<Object> NewIntArray(const int64_t* data, size_t size) {
+  ArrayObject::Ints ints = ArrayObject::Ints::Uninitialized(size);
+  std::copy(data, data + size, ints.MutableData());
+  return std::make_shared<ArrayObject>(ints);
+}
+
+std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& fn, ObjectSpan args) {
+  return ApplyFunction(fn, std::vector<std::shared_ptr<Object>>(args.begin(), args.end()));
+}
+
+ObjectType TypeOf(const std::shared_ptr<Object>& obj) {
+  return obj->Type();
+}
+
+bool GetInteger(const std::shared_ptr<Object>& obj, int64_t* value) {
+  if (obj->Type() != ObjectType::kInteger) {
+    return false;
+  }
+  *value = static_cast<IntegerObject*>(obj.get())->value;
+  return true;
+}
+
+bool GetFloat(const std::shared_ptr<Object>& obj, double* value) {
+  if (obj->Type() != ObjectType::kFloat) {
+    return false;
+  }
+  *value = static_cast<FloatObject*>(obj.get())->value;
+  return true;
+}
+
+bool GetBoolean(const std::shared_ptr<Object>& obj, bool* value) {
+  if (obj->Type() != ObjectType::kBoolean) {
+    return false;
+  }
+  *value = static_cast<BooleanObject*>(obj.get())->value;
+  return true;
+}
+
+bool GetString(const std::shared_ptr<Object>& obj, const char** data, size_t* size) {
+  if (obj->Type() != ObjectType::kString) {
+    return false;
+  }
+  std::string_view value = static_cast<StringObject*>(obj.get())->View();
+  *data = value.data();
+  *size = value.size();
+  return true;
+}
+
+bool ArraySize(const std::shared_ptr<Object>& obj, size_t* size) {
+  if (obj->Type() != ObjectType::kArray) {
+    return false;
+  }
+  *size = static_cast<ArrayObject*>(obj.get())->Size();
+  return true;
+}
+
+std::shared_ptr<Object> ArrayElement(const std::shared_ptr<Object>& obj, size_t i) {
+  if (obj->Type() != ObjectType::kArray || i >= static_cast<ArrayObject*>(obj.get())->Size()) {
+    return nullptr;
+  }
+  return static_cast<ArrayObject*>(obj.get())->At(i);
+}
+
+bool GetIntArray(const std::shared_ptr<Object>& obj, const int64_t** data, size_t* size) {
+  if (obj->Type() != ObjectType::kArray || !static_cast<ArrayObject*>(obj.get())->IsInts()) {
+    return false;
+  }
+  const ArrayObject::Ints& ints = static_cast<ArrayObject*>(obj.get())->ints;
+  *data = ints.data();
+  *size = ints.size();
+  return true;
+}
+
+const GokuHost kHost = {
+    GOKU_EXTENSION_ABI_VERSION,
+    RegisterBuiltIn,
+    NewInteger,
+    NewBoolean,
+    NewNull,
+    NewString,
+    NewError,
+    NewArray,
+    NewIntArray,
+    Apply,
+    TypeOf,
+    GetInteger,
+    GetFloat,
+    GetBoolean,
+    GetString,
+    ArraySize,
+    ArrayElement,
+    GetIntArray,
+};
+
+}  // namespace
+
+std::string LoadExtension(const std::string& path) {
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (handle == nullptr) {
+    return "cannot load extension: " + std::string(dlerror());
+  }
+  ExtensionInitFnType init = reinterpret_cast<ExtensionInitFnType>(dlsym(handle, GOKU_EXTENSION_INIT_SYMBOL));
+  if (init == nullptr) {
+    dlclose(handle);
+    return "not a goku extension: " + path;
+  }
+  // The library stays loaded even if init fails: it may have registered
+  // builtins before failing.
+  if (!init(&kHost)) {
+    return "extension failed to initialize: " + path;
+  }
+  return "";
+}
+
+NativeFnType FindExtensionBuiltIn(const std::string& name) {
+  auto iter = Registry().find(name);
+  return iter == Registry().end() ? nullptr : iter->second;
+}
+
+const std::map<std::string, NativeFnType>& ExtensionBuiltIns() {
+  return Registry();
+}
@@ -0,0 +1,117 @@
+#ifndef SRC_EXTENSION_H_
+#define SRC_EXTENSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+// Native extensions are shared libraries exporting
+//
+//   extern "C" bool goku_extension_init(const GokuHost* host);
+//
+// which checks host->abi_version and registers its builtins through the
+// host. Extensions read arguments with the host's accessors and must create
+// every object they return with its allocators, so objects are always
+// built, read and freed by the interpreter's code and extensions do not
+// depend on the layout of the object classes.
+
+// Covers GokuHost, ObjectType and the layout of the object.h classes, for
+// extensions that still read those directly, so it is bumped whenever any
+// of them changes.
+#define GOKU_EXTENSION_ABI_VERSION 3
+#define GOKU_EXTENSION_INIT_SYMBOL "goku_extension_init"
+
+class Object;
+
+// Extensions compare these values, so new types go last and existing ones
+// are never renumbered.
+enum class ObjectType {
+  kInteger,
+  kBoolean,
+  kNull,
+  kReturnValue,
+  kError,
+  kFunction,
+  kString,
+  kBuiltIn,
+  kArray,
+  kHash,
+  kStringBuilder,
+  kSequence,
+  kFloat,
+  kTask,
+  kChannel,
+};
+
+// A non-owning view of call arguments, valid until the call returns.
+class ObjectSpan {
+ public:
+  ObjectSpan() : data_(nullptr), size_(0) {}
+  ObjectSpan(const std::shared_ptr<Object>* data, size_t size) : data_(data), size_(size) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const std::shared_ptr<Object>& operator[](size_t i) const { return data_[i]; }
+
+  const std::shared_ptr<Object>* begin() const { return data_; }
+  const std::shared_ptr<Object>* end() const { return data_ + size_; }
+
+ private:
+  const std::shared_ptr<Object>* data_;
+  size_t size_;
+};
+
+using NativeFnType = std::shared_ptr<Object> (*)(ObjectSpan args);
+
+// Services the interpreter provides to extensions. Later ABI versions only
+// append fields; anything else bumps GOKU_EXTENSION_ABI_VERSION.
+struct GokuHost {
+  uint32_t abi_version;
+
+  // Fails if the name is taken by a core builtin or another extension.
+  bool (*register_builtin)(const char* name, NativeFnType fn);
+
+  std::shared_ptr<Object> (*new_integer)(int64_t value);
+  std::shared_ptr<Object> (*new_boolean)(bool value);
+  std::shared_ptr<Object> (*new_null)();
+  std::shared_ptr<Object> (*new_string)(const char* data, size_t size);
+  std::shared_ptr<Object> (*new_error)(const char* message);
+  std::shared_ptr<Object> (*new_array)(ObjectSpan elements);
+  std::shared_ptr<Object> (*new_int_array)(const int64_t* data, size_t size);
+
+  // Calls a script function or builtin, like the evaluator does.
+  std::shared_ptr<Object> (*apply)(const std::shared_ptr<Object>& fn, ObjectSpan args);
+
+  // Accessors. Those returning bool fail if obj has another type.
+  ObjectType (*type_of)(const std::shared_ptr<Object>& obj);
+  bool (*get_integer)(const std::shared_ptr<Object>& obj, int64_t* value);
+  bool (*get_float)(const std::shared_ptr<Object>& obj, double* value);
+  bool (*get_boolean)(const std::shared_ptr<Object>& obj, bool* value);
+  // The characters stay valid while obj is alive.
+  bool (*get_string)(const std::shared_ptr<Object>& obj, const char** data, size_t* size);
+  bool (*array_size)(const std::shared_ptr<Object>& obj, size_t* size);
+  // Returns nullptr unless obj is an array with an element i.
+  std::shared_ptr<Object> (*array_element)(const std::shared_ptr<Object>& obj, size_t i);
+  // The elements of an array stored as unboxed integers, valid while obj is
+  // alive. Fails for any other array, even one holding only integers.
+  bool (*get_int_array)(const std::shared_ptr<Object>& obj, const int64_t** data, size_t* size);
+};
+
+using ExtensionInitFnType = bool (*)(const GokuHost* host);
+
+// Interpreter side. Extensions are loaded at startup, before any script is
+// parsed, and stay loaded for the life of the process.
+
+// Returns an empty string on success, otherwise why loading failed.
+std::string LoadExtension(const std::string& path);
+
+// Returns nullptr if no extension registered the name.
+NativeFnType FindExtensionBuiltIn(const std::string& name);
+
+// Every builtin registered by the loaded extensions, by name.
+const std::map<std::string, NativeFnType>& ExtensionBuiltIns();
+
+#endif  // SRC_EXTENSION_H_
@@ -0,0 +1,281 @@
+#include "builtins.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "ast.h"
+#include "mapped_file.h"
+
+// read_file maps regular files and returns a string viewing the mapping,
+// so reading a file copies nothing until something needs a std::string.
+// It falls back to buffered reads for pipes and other unmappable files.
+// The mapping is only safe while nothing truncates the file: reading a
+// page past its new end kills the process with SIGBUS. lines streams
+// instead, through a large read() buffer, as it is meant for huge and
+// growing files such as logs that may be rotated while being read.
+// write_file streams its content through a stdio buffer.
+
+namespace {
+
+// Files smaller than this are read into an ordinary string; mapping them
+// costs more than the copy.
+const size_t kMinMappedSize = 64 * 1024;
+
+const size_t kReadBufferSize = 1 << 20;
+const size_t kWriteBufferSize = 1 << 20;
+
+std::shared_ptr<Object> IOError(const std::string& what, const std::string& path) {
+  return std::make_shared<ErrorObject>(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Maps path if it is a regular file of at least min_size bytes. Returns an
+// error object if the file can not be opened; otherwise *out is the mapping,
+// or nullptr if the file should be read instead.
+std::shared_ptr<Object> MapFile(const std::string& path, size_t min_size, std::shared_ptr<MappedFile>* out) {
+  *out = nullptr;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return IOError("cannot open", path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && static_cast<size_t>(st.st_size) >= min_size &&
+      st.st_size > 0) {
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      *out = std::make_shared<MappedFile>(data, st.st_size);
+    }
+  }
+  close(fd);
+  return nullptr;
+}
+
+std::shared_ptr<Object> ReadAll(const std::string& path, std::string* out) {
+  std::FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return IOError("cannot open", path);
+  }
+  char buffer[1 << 16];
+  size_t n;
+  while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    out->append(buffer, n);
+  }
+  bool failed = std::ferror(file);
+  std::fclose(file);
+  if (failed) {
+    return IOError("cannot read", path);
+  }
+  return nullptr;
+}
+
+class LinesCursor : public SequenceObject::Cursor {
+ public:
+  explicit LinesCursor(const std::string& path)
+      : path_(path), fd_(open(path.c_str(), O_RDONLY)), buffer_(new char[kReadBufferSize]),
+        next_(buffer_.get()), end_(buffer_.get()) {
+#ifdef POSIX_FADV_SEQUENTIAL
+    if (fd_ >= 0) {
+      posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#endif
+  }
+
+  ~LinesCursor() override {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  bool Next(std::shared_ptr<Object>* value) override {
+    if (fd_ < 0) {
+      if (path_.empty()) {
+        return false;
+      }
+      *value = IOError("cannot open", path_);
+      path_.clear();
+      return true;
+    }
+    std::string line;
+    bool partial = false;
+    while (true) {
+      if (next_ == end_) {
+        ssize_t n = read(fd_, buffer_.get(), kReadBufferSize);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n < 0) {
+          *value = IOError("cannot read", path_);
+          close(fd_);
+          fd_ = -1;
+          path_.clear();
+          return true;
+        }
+        if (n == 0) {
+          // The last line may lack its terminator.
+          if (!partial) {
+            return false;
+          }
+          break;
+        }
+        next_ = buffer_.get();
+        end_ = next_ + n;
+      }
+      const char* newline = static_cast<const char*>(std::memchr(next_, '\n', end_ - next_));
+      if (newline == nullptr) {
+        line.append(next_, end_);
+        next_ = end_;
+        partial = true;
+        continue;
+      }
+      line.append(next_, newline);
+      next_ = newline + 1;
+      break;
+    }
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    *value = std::make_shared<StringObject>(std::move(line));
+    return true;
+  }
+
+ private:
+  std::string path_;
+  int fd_;
+  std::unique_ptr<char[]> buffer_;
+  // The unread part of buffer_.
+  const char* next_;
+  const char* end_;
+};
+
+class LinesSource : public SequenceObject::Source {
+ public:
+  explicit LinesSource(std::string path) : path_(std::move(path)) {}
+
+  std::unique_ptr<SequenceObject::Cursor> Open() const override {
+    return std::unique_ptr<SequenceObject::Cursor>(new LinesCursor(path_));
+  }
+
+ private:
+  std::string path_;
+};
+
+std::shared_ptr<Object> CheckPath(const std::vector<std::shared_ptr<Object>>& args, const std::string& name,
+                                  size_t want) {
+  if (args.size() != want) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (args[0]->Type() != ObjectType::kString) {
+    return std::make_shared<ErrorObject>("path of " + name + " must be String, got " + ObjectTypeToString(args[0]->Type()));
+  }
+  return nullptr;
+}
+
+// Writes strings as they are and anything else as it would print.
+bool WriteObject(std::FILE* file, const std::shared_ptr<Object>& obj) {
+  if (obj->Type() == ObjectType::kString) {
+    std::string_view value = static_cast<StringObject*>(obj.get())->View();
+    return std::fwrite(value.data(), 1, value.size(), file) == value.size();
+  }
+  std::string value = obj->Inspect();
+  return std::fwrite(value.data(), 1, value.size(), file) == value.size();
+}
+
+}  // namespace
+
+std::shared_ptr<Object> BuiltInReadFile(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckPath(args, "read_file", 1);
+  if (err != nullptr) {
+    return err;
+  }
+  const std::string& path = static_cast<StringObject*>(args[0].get())->Value();
+  std::shared_ptr<MappedFile> file;
+  err = MapFile(path, kMinMappedSize, &file);
+  if (err != nullptr) {
+    return err;
+  }
+  if (file != nullptr) {
+    const char* data = file->data();
+    size_t size = file->size();
+    return std::make_shared<StringObject>(std::move(file), data, size);
+  }
+  std::string content;
+  err = ReadAll(path, &content);
+  if (err != nullptr) {
+    return err;
+  }
+  return std::make_shared<StringObject>(std::move(content));
+}
+
+// lines(path) is a lazy sequence of the file's lines without their line
+// terminators. The file is opened anew each time the sequence is consumed.
+std::shared_ptr<Object> BuiltInLines(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckPath(args, "lines", 1);
+  if (err != nullptr) {
+    return err;
+  }
+  const std::string& path = static_cast<StringObject*>(args[0].get())->Value();
+  if (access(path.c_str(), R_OK) != 0) {
+    return IOError("cannot open", path);
+  }
+  return std::make_shared<SequenceObject>(std::make_shared<LinesSource>(path));
+}
+
+// write_file(path, content) writes a string or builder as it is, or the
+// elements of an array or sequence one per line. Returns the number of
+// bytes written.
+std::shared_ptr<Object> BuiltInWriteFile(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckPath(args, "write_file", 2);
+  if (err != nullptr) {
+    return err;
+  }
+  const std::string& path = static_cast<StringObject*>(args[0].get())->Value();
+  const std::shared_ptr<Object>& content = args[1];
+  ObjectType type = content->Type();
+  if (type != ObjectType::kString && type != ObjectType::kStringBuilder &&
+      type != ObjectType::kArray && type != ObjectType::kSequence) {
+    return std::make_shared<ErrorObject>("content of write_file must be String, StringBuilder, Array or Sequence, got " +
+                                         ObjectTypeToString(type));
+  }
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return IOError("cannot open", path);
+  }
+  std::unique_ptr<char[]> buffer(new char[kWriteBufferSize]);
+  std::setvbuf(file, buffer.get(), _IOFBF, kWriteBufferSize);
+
+  bool ok = true;
+  auto write_line = [&ok, file](const std::shared_ptr<Object>& obj) {
+    ok = ok && WriteObject(file, obj) && std::fputc('\n', file) != EOF;
+    return ok;
+  };
+  if (type == ObjectType::kString) {
+    ok = WriteObject(file, content);
+  } else if (type == ObjectType::kStringBuilder) {
+    StringBuilderObject* builder = static_cast<StringBuilderObject*>(content.get());
+    std::lock_guard<std::mutex> lock(builder->mutex);
+    ok = std::fwrite(builder->buffer.data(), 1, builder->buffer.size(), file) == builder->buffer.size();
+  } else if (type == ObjectType::kArray) {
+    static_cast<ArrayObject*>(content.get())->ForEach(write_line);
+  } else {
+    err = static_cast<SequenceObject*>(content.get())->Run(write_line);
+  }
+  long size = std::ftell(file);
+  ok = ok && size >= 0;
+  if (std::fclose(file) != 0) {
+    ok = false;
+  }
+  if (err != nullptr) {
+    return err;
+  }
+  if (!ok) {
+    return IOError("cannot write", path);
+  }
+  return std::make_shared<IntegerObject>(size);
+}
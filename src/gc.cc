@@ -0,0 +1,335 @@
+#include "gc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ast.h"
+#include "object.h"
+#include "thread_pool.h"
+
+namespace {
+
+thread_local Heap* current_heap = nullptr;
+
+// Whether obj holds other objects. Such objects can be shared and form
+// cycles, so walks visit each only once.
+bool IsContainer(Object* obj) {
+  switch (obj->Type()) {
+  case ObjectType::kArray:
+    return static_cast<ArrayObject*>(obj)->IsGeneric();
+  case ObjectType::kHash:
+  case ObjectType::kSequence:
+  case ObjectType::kTask:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Passes the objects obj holds to f. Functions hold an environment instead,
+// which callers handle themselves.
+template <typename F>
+void ForEachChild(Object* obj, const F& f) {
+  switch (obj->Type()) {
+  case ObjectType::kReturnValue:
+    f(static_cast<ReturnValueObject*>(obj)->value.get());
+    break;
+  case ObjectType::kArray:
+    if (static_cast<ArrayObject*>(obj)->IsGeneric()) {
+      static_cast<ArrayObject*>(obj)->ForEach([&f](const std::shared_ptr<Object>& elem) { f(elem.get()); });
+    }
+    break;
+  case ObjectType::kHash:
+    for (auto& entry : static_cast<HashObject*>(obj)->table) {
+      f(entry.key.get());
+      f(entry.value.get());
+    }
+    break;
+  case ObjectType::kSequence: {
+    SequenceObject* seq = static_cast<SequenceObject*>(obj);
+    seq->source->ForEachReference(f);
+    for (auto& stage : seq->stages) {
+      f(stage.fn.get());
+    }
+    break;
+  }
+  case ObjectType::kTask: {
+    TaskObject* task = static_cast<TaskObject*>(obj);
+    f(task->fn.get());
+    for (auto& arg : task->args) {
+      f(arg.get());
+    }
+    if (task->Done()) {
+      f(task->result().get());
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+}  // namespace
+
+// Worklists of a single mark phase.
+struct Heap::MarkState {
+  std::vector<Environment*> envs;
+  std::vector<Object*> objects;
+  std::unordered_set<Object*> visited;
+};
+
+// The objects HostRoots registered, by root. HostRoots may come and go on
+// any thread.
+struct Heap::Roots {
+  std::mutex mutex;
+  std::unordered_map<const HostRoot*, std::shared_ptr<Object>> objects;
+};
+
+Heap::Heap(const GcOptions& options) : options_(options), roots_(std::make_shared<Roots>()) {}
+
+Heap::~Heap() {
+  if (queued_.load(std::memory_order_acquire) != 0) {
+    // A spare worker runs queued tasks meanwhile, even in a pool without
+    // workers of its own.
+    bool blocking = ThreadPool::Default().BeginBlocking();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      tasks_done_.wait(lock, [this]() { return queued_.load(std::memory_order_acquire) == 0; });
+    }
+    if (blocking) {
+      ThreadPool::Default().EndBlocking();
+    }
+  }
+  // Nothing outlives the heap as a root, so whatever is still registered is
+  // kept alive by cycles only. That includes what hosts still hold: closures
+  // do not outlive their interpreter's heap.
+  {
+    std::lock_guard<std::mutex> lock(roots_->mutex);
+    roots_->objects.clear();
+  }
+  Collect({}, {});
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Environment* env = head_; env != nullptr; env = env->gc_next_) {
+    env->heap_ = nullptr;
+  }
+  if (current_heap == this) {
+    current_heap = nullptr;
+  }
+}
+
+void Heap::TaskReleased() {
+  // Under the lock, so the destructor can not return between the count
+  // dropping to 0 and the notification.
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (queued_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    tasks_done_.notify_all();
+  }
+}
+
+Heap* Heap::Current() {
+  return current_heap;
+}
+
+void Heap::SetCurrent(Heap* heap) {
+  current_heap = heap;
+}
+
+void Heap::Register(Environment* env) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  env->heap_ = this;
+  env->gc_next_ = head_;
+  if (head_ != nullptr) {
+    head_->gc_prev_ = env;
+  }
+  head_ = env;
+  ++allocated_since_gc_;
+  ++stats_.live_environments;
+  if (stats_.live_environments > stats_.peak_environments) {
+    stats_.peak_environments = stats_.live_environments;
+  }
+}
+
+void Heap::Unregister(Environment* env) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (env->gc_prev_ != nullptr) {
+    env->gc_prev_->gc_next_ = env->gc_next_;
+  } else {
+    head_ = env->gc_next_;
+  }
+  if (env->gc_next_ != nullptr) {
+    env->gc_next_->gc_prev_ = env->gc_prev_;
+  }
+  env->heap_ = nullptr;
+  --stats_.live_environments;
+}
+
+bool Heap::MaybeCollect(const std::vector<std::shared_ptr<Environment>>& env_roots,
+                        const std::vector<std::shared_ptr<Object>>& object_roots) {
+  if (tasks_.load(std::memory_order_acquire) != 0) {
+    return true;
+  }
+  if (ShouldCollect() || OverLimit()) {
+    Collect(env_roots, object_roots);
+  }
+  return !OverLimit();
+}
+
+void Heap::MarkEnvironment(Environment* env, MarkState& state) {
+  if (env != nullptr && (env->heap_ == this || env->heap_ == nullptr) && env->gc_mark_ != epoch_) {
+    env->gc_mark_ = epoch_;
+    state.envs.push_back(env);
+  }
+}
+
+void Heap::Mark(const std::vector<std::shared_ptr<Environment>>& env_roots,
+                const std::vector<std::shared_ptr<Object>>& object_roots) {
+  MarkState state;
+  for (auto& env : env_roots) {
+    MarkEnvironment(env.get(), state);
+  }
+  for (auto& obj : object_roots) {
+    state.objects.push_back(obj.get());
+  }
+  while (!state.envs.empty() || !state.objects.empty()) {
+    while (!state.objects.empty()) {
+      Object* obj = state.objects.back();
+      state.objects.pop_back();
+      Trace(obj, state);
+    }
+    if (!state.envs.empty()) {
+      Environment* env = state.envs.back();
+      state.envs.pop_back();
+      MarkEnvironment(env->outer.get(), state);
+      for (auto& pair : env->objects) {
+        state.objects.push_back(pair.second.get());
+      }
+    }
+  }
+}
+
+void Heap::Trace(Object* obj, MarkState& state) {
+  if (obj == nullptr) {
+    return;
+  }
+  if (obj->Type() == ObjectType::kFunction) {
+    MarkEnvironment(static_cast<FunctionObject*>(obj)->env.get(), state);
+    return;
+  }
+  if (IsContainer(obj) && !state.visited.insert(obj).second) {
+    return;
+  }
+  ForEachChild(obj, [&state](Object* child) { state.objects.push_back(child); });
+}
+
+void Heap::Collect(const std::vector<std::shared_ptr<Environment>>& env_roots,
+                   const std::vector<std::shared_ptr<Object>>& object_roots) {
+  auto begin = std::chrono::steady_clock::now();
+  ++epoch_;
+  if (epoch_ == 0) {
+    // Marks from 2^32 cycles ago could alias the new epoch.
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Environment* env = head_; env != nullptr; env = env->gc_next_) {
+      env->gc_mark_ = 0;
+    }
+    epoch_ = 1;
+  }
+  std::vector<std::shared_ptr<Object>> roots = object_roots;
+  {
+    std::lock_guard<std::mutex> lock(roots_->mutex);
+    for (auto& root : roots_->objects) {
+      roots.push_back(root.second);
+    }
+  }
+  Mark(env_roots, roots);
+
+  // Pin the garbage first: dropping bindings of one environment may free
+  // another one further down the list. Other threads, say a host dropping
+  // a Value, may be freeing environments meanwhile; those that are already
+  // on their way out are skipped.
+  std::vector<std::shared_ptr<Environment>> garbage;
+  size_t live_before;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Environment* env = head_; env != nullptr; env = env->gc_next_) {
+      if (env->gc_mark_ != epoch_) {
+        if (std::shared_ptr<Environment> pinned = env->weak_from_this().lock()) {
+          garbage.push_back(std::move(pinned));
+        }
+      }
+    }
+    live_before = stats_.live_environments;
+  }
+  for (auto& env : garbage) {
+    env->objects.clear();
+    env->index_.clear();
+    env->outer = nullptr;
+  }
+  garbage.clear();
+
+  int64_t pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - begin).count();
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.collections;
+  stats_.freed_environments += live_before - stats_.live_environments;
+  stats_.last_pause_ns = pause;
+  stats_.total_pause_ns += pause;
+  if (pause > stats_.max_pause_ns) {
+    stats_.max_pause_ns = pause;
+  }
+  allocated_since_gc_ = 0;
+}
+
+std::shared_ptr<HostRoot> HostRoot::Make(std::shared_ptr<Object> object) {
+  // Most results are scalars, strings or unboxed arrays, which cannot hold
+  // a closure; don't set up a walk for those.
+  if (object == nullptr ||
+      (object->Type() != ObjectType::kFunction && object->Type() != ObjectType::kReturnValue &&
+       !IsContainer(object.get()))) {
+    return nullptr;
+  }
+  // Find the heaps of the environments the object's closures captured.
+  // Their scopes are marked from there by each heap's own collections.
+  std::vector<Heap*> heaps;
+  std::vector<Object*> work = {object.get()};
+  std::unordered_set<Object*> visited;
+  while (!work.empty()) {
+    Object* obj = work.back();
+    work.pop_back();
+    if (obj == nullptr) {
+      continue;
+    }
+    if (obj->Type() == ObjectType::kFunction) {
+      Environment* env = static_cast<FunctionObject*>(obj)->env.get();
+      Heap* heap = env != nullptr ? env->heap_ : nullptr;
+      if (heap != nullptr && std::find(heaps.begin(), heaps.end(), heap) == heaps.end()) {
+        heaps.push_back(heap);
+      }
+      continue;
+    }
+    if (IsContainer(obj) && !visited.insert(obj).second) {
+      continue;
+    }
+    ForEachChild(obj, [&work](Object* child) { work.push_back(child); });
+  }
+  if (heaps.empty()) {
+    return nullptr;
+  }
+  std::shared_ptr<HostRoot> root = std::make_shared<HostRoot>(std::move(object));
+  for (Heap* heap : heaps) {
+    std::lock_guard<std::mutex> lock(heap->roots_->mutex);
+    heap->roots_->objects.emplace(root.get(), root->object_);
+    root->roots_.push_back(heap->roots_);
+  }
+  return root;
+}
+
+HostRoot::~HostRoot() {
+  for (auto& weak : roots_) {
+    if (std::shared_ptr<Heap::Roots> roots = weak.lock()) {
+      std::lock_guard<std::mutex> lock(roots->mutex);
+      roots->objects.erase(this);
+    }
+  }
+}
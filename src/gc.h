@@ -0,0 +1,158 @@
+#ifndef SRC_GC_H_
+#define SRC_GC_H_
+
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class Object;
+class Environment;
+
+struct GcOptions {
+  // A collection is attempted at the next safe point once this many
+  // environments were created since the previous one.
+  size_t collect_threshold = 4096;
+  // Upper bound of live environments after a collection, 0 means unlimited.
+  size_t max_environments = 0;
+};
+
+struct GcStats {
+  size_t collections = 0;
+  size_t freed_environments = 0;
+  size_t live_environments = 0;
+  size_t peak_environments = 0;
+  int64_t last_pause_ns = 0;
+  int64_t max_pause_ns = 0;
+  int64_t total_pause_ns = 0;
+};
+
+// Heap tracks every Environment created while it is current and breaks the
+// reference cycles that shared_ptr can not reclaim on its own: a closure
+// holds its defining environment, which in turn holds the closure.
+//
+// Collection is a precise mark-sweep over environments. Starting from the
+// roots, everything reachable through bindings, closures and containers is
+// marked; unmarked environments are only alive because of cycles, so their
+// bindings are dropped and shared_ptr frees the rest. Collections only run
+// at safe points (between top-level statements) where the roots are exactly
+// the global environment, the values held by the evaluator and what the
+// host holds through HostRoots. Environments of other heaps are left to
+// their own heap. Parallel
+// builtins install the heap on their worker threads and return before the
+// next safe point. Tasks started by spawn may outlive a safe point, which
+// then skips collecting.
+class Heap {
+ public:
+  explicit Heap(const GcOptions& options = GcOptions());
+  ~Heap();
+
+  Heap(const Heap&) = delete;
+  Heap& operator=(const Heap&) = delete;
+
+  static Heap* Current();
+  static void SetCurrent(Heap* heap);
+
+  void Register(Environment* env);
+  void Unregister(Environment* env);
+
+  // Tasks spawned on this heap. Their environments are only rooted on
+  // their threads' stacks, so collections are put off between TaskStarted
+  // and TaskFinished. The pool's reference to a task, which may be the
+  // last one, goes at TaskReleased, afterwards even if another thread ran
+  // the task; the destructor waits for that. Owners cancel the tasks'
+  // evaluations first, so tasks blocked on a channel give up.
+  void TaskStarted() {
+    tasks_.fetch_add(1, std::memory_order_relaxed);
+    queued_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void TaskFinished() { tasks_.fetch_sub(1, std::memory_order_release); }
+  void TaskReleased();
+
+  bool ShouldCollect() const {
+    return allocated_since_gc_ >= options_.collect_threshold;
+  }
+
+  // Collects if the threshold was reached. Returns false if the heap is still
+  // above its configured limit afterwards.
+  bool MaybeCollect(const std::vector<std::shared_ptr<Environment>>& env_roots,
+                    const std::vector<std::shared_ptr<Object>>& object_roots);
+
+  void Collect(const std::vector<std::shared_ptr<Environment>>& env_roots,
+               const std::vector<std::shared_ptr<Object>>& object_roots);
+
+  bool OverLimit() const {
+    return options_.max_environments != 0 &&
+           stats_.live_environments > options_.max_environments;
+  }
+
+  const GcOptions& options() const { return options_; }
+  GcStats stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  friend class HostRoot;
+
+  struct MarkState;
+  struct Roots;
+
+  void MarkEnvironment(Environment* env, MarkState& state);
+  void Mark(const std::vector<std::shared_ptr<Environment>>& env_roots,
+            const std::vector<std::shared_ptr<Object>>& object_roots);
+  void Trace(Object* obj, MarkState& state);
+
+  GcOptions options_;
+  // Guards the environment list and stats_: environments may be created
+  // and freed on worker threads. Collections themselves only run at safe
+  // points where no other thread evaluates.
+  mutable std::mutex mutex_;
+  GcStats stats_;
+  size_t allocated_since_gc_ = 0;
+  std::atomic<size_t> tasks_{0};
+  std::atomic<size_t> queued_{0};
+  // Signalled under mutex_ when the last task was released.
+  std::condition_variable tasks_done_;
+  uint32_t epoch_ = 0;
+  Environment* head_ = nullptr;
+  std::shared_ptr<Roots> roots_;
+};
+
+// Keeps an object the host holds outside of any environment, say a
+// script's result or a binding in another interpreter, from losing the
+// environments it reaches: every heap managing one of them treats the
+// object as a root while the HostRoot lives. It does not keep those heaps
+// alive, and a heap going away drops the scopes it managed regardless.
+class HostRoot {
+ public:
+  // Returns nullptr if object reaches no environment managed by a heap.
+  static std::shared_ptr<HostRoot> Make(std::shared_ptr<Object> object);
+
+  explicit HostRoot(std::shared_ptr<Object> object) : object_(std::move(object)) {}
+  ~HostRoot();
+
+  HostRoot(const HostRoot&) = delete;
+  HostRoot& operator=(const HostRoot&) = delete;
+
+ private:
+  std::shared_ptr<Object> object_;
+  std::vector<std::weak_ptr<Heap::Roots>> roots_;
+};
+
+// Installs a heap as current for the lifetime of the scope.
+class HeapScope {
+ public:
+  explicit HeapScope(Heap* heap) : saved_(Heap::Current()) {
+    Heap::SetCurrent(heap);
+  }
+  ~HeapScope() { Heap::SetCurrent(saved_); }
+
+ private:
+  Heap* saved_;
+};
+
+#endif  // SRC_GC_H_
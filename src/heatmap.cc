@@ -0,0 +1,113 @@
+#include "heatmap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+
+#include "ast.h"
+
+namespace {
+
+// Nodes listed after the annotated source.
+const size_t kHottestNodes = 20;
+const size_t kMaxText = 48;
+
+using HeatKey = std::tuple<int, int, std::type_index>;
+
+// Entries are never freed, so nodes can keep pointers to them.
+std::mutex entries_mutex;
+std::map<HeatKey, std::unique_ptr<HeatEntry>> entries;
+
+thread_local HeatScope* current_scope = nullptr;
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+HeatEntry* HeatSlot::lookup(Node* node, const Token& token) {
+  std::lock_guard<std::mutex> lock(entries_mutex);
+  std::unique_ptr<HeatEntry>& entry = entries[HeatKey(token.line, token.column, std::type_index(typeid(*node)))];
+  if (entry == nullptr) {
+    entry = std::make_unique<HeatEntry>();
+    entry->line = token.line;
+    entry->column = token.column;
+    entry->text = node->String();
+    std::replace(entry->text.begin(), entry->text.end(), '\n', ' ');
+    std::replace(entry->text.begin(), entry->text.end(), '\t', ' ');
+    if (entry->text.size() > kMaxText) {
+      entry->text.resize(kMaxText - 3);
+      entry->text += "...";
+    }
+  }
+  return entry.get();
+}
+
+HeatScope::HeatScope(HeatSlot* slot, Node* node, const Token& token)
+    : entry_(slot->Get(node, token)), parent_(current_scope), start_ns_(NowNs()) {
+  entry_->hits.fetch_add(1, std::memory_order_relaxed);
+  current_scope = this;
+}
+
+HeatScope::~HeatScope() {
+  int64_t elapsed = NowNs() - start_ns_;
+  entry_->ns.fetch_add(elapsed - children_ns_, std::memory_order_relaxed);
+  if (parent_ != nullptr) {
+    parent_->children_ns_ += elapsed;
+  }
+  current_scope = parent_;
+}
+
+void WriteHeatmap(std::ostream& out, const std::string& source) {
+  std::lock_guard<std::mutex> lock(entries_mutex);
+  std::map<int, std::pair<uint64_t, int64_t>> lines;
+  std::vector<const HeatEntry*> hottest;
+  for (auto& pair : entries) {
+    const HeatEntry* entry = pair.second.get();
+    auto& line = lines[entry->line];
+    line.first += entry->hits.load(std::memory_order_relaxed);
+    line.second += entry->ns.load(std::memory_order_relaxed);
+    hottest.push_back(entry);
+  }
+  char prefix[64];
+  if (!source.empty()) {
+    std::istringstream in(source);
+    std::string text;
+    for (int number = 1; std::getline(in, text); ++number) {
+      auto line = lines.find(number);
+      if (line == lines.end()) {
+        std::snprintf(prefix, sizeof(prefix), "%12s %10s | ", "", "");
+      } else {
+        std::snprintf(prefix, sizeof(prefix), "%12llu %10.3f | ", static_cast<unsigned long long>(line->second.first),
+                      line->second.second / 1e6);
+      }
+      out << prefix << text << '\n';
+    }
+    out << '\n';
+  }
+  std::sort(hottest.begin(), hottest.end(), [](const HeatEntry* lhs, const HeatEntry* rhs) {
+    return lhs->ns.load(std::memory_order_relaxed) > rhs->ns.load(std::memory_order_relaxed);
+  });
+  if (hottest.size() > kHottestNodes) {
+    hottest.resize(kHottestNodes);
+  }
+  std::snprintf(prefix, sizeof(prefix), "%12s %10s  %-10s ", "hits", "self ms", "position");
+  out << prefix << "node\n";
+  for (const HeatEntry* entry : hottest) {
+    std::string position = std::to_string(entry->line) + ":" + std::to_string(entry->column);
+    std::snprintf(prefix, sizeof(prefix), "%12llu %10.3f  %-10s ",
+                  static_cast<unsigned long long>(entry->hits.load(std::memory_order_relaxed)),
+                  entry->ns.load(std::memory_order_relaxed) / 1e6, position.c_str());
+    out << prefix << entry->text << '\n';
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef SRC_HEATMAP_H_
+#define SRC_HEATMAP_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Evaluation counts and time per syntax node, built with -DGOKU_HEATMAP=ON.
+// Otherwise none of this is compiled in: the GOKU_HEAT hooks in ast.h
+// expand to nothing and nodes carry no extra field.
+//
+// Nodes are aggregated by kind and source position, so the nodes of every
+// REPL line land on line 1. Time is exclusive: a node's time leaves out
+// the nodes it evaluates, so the times of a line add up to the time spent
+// on it. Reading the clock around every node slows evaluation down
+// several times over.
+
+class Node;
+struct Token;
+
+struct HeatEntry {
+  int line;
+  int column;
+  // The node's source, shortened.
+  std::string text;
+  std::atomic<uint64_t> hits{0};
+  std::atomic<int64_t> ns{0};
+};
+
+// A node's entry, looked up on its first evaluation. Copies start over.
+class HeatSlot {
+ public:
+  HeatSlot() {}
+  HeatSlot(const HeatSlot&) {}
+  HeatSlot& operator=(const HeatSlot&) { return *this; }
+
+  HeatEntry* Get(Node* node, const Token& token) {
+    HeatEntry* entry = entry_.load(std::memory_order_acquire);
+    if (entry == nullptr) {
+      entry = lookup(node, token);
+      entry_.store(entry, std::memory_order_release);
+    }
+    return entry;
+  }
+
+ private:
+  static HeatEntry* lookup(Node* node, const Token& token);
+
+  std::atomic<HeatEntry*> entry_{nullptr};
+};
+
+// Counts one evaluation of a node and times it.
+class HeatScope {
+ public:
+  HeatScope(HeatSlot* slot, Node* node, const Token& token);
+  ~HeatScope();
+
+  HeatScope(const HeatScope&) = delete;
+  HeatScope& operator=(const HeatScope&) = delete;
+
+ private:
+  HeatEntry* entry_;
+  HeatScope* parent_;
+  int64_t start_ns_;
+  int64_t children_ns_ = 0;
+};
+
+// An annotated listing of source, with the hits and milliseconds of every
+// line, followed by the hottest nodes. Without source, only the latter.
+void WriteHeatmap(std::ostream& out, const std::string& source);
+
+#endif  // SRC_HEATMAP_H_
@@ -0,0 +1,118 @@
+#include "interpreter.h"
+
+#include <atomic>
+
+#include "ast.h"
+#include "lexer/lexer.h"
+#include "parser.h"
+#include "snapshot.h"
+
+namespace {
+
+std::atomic<uint64_t> next_interpreter_id{1};
+
+}  // namespace
+
+Interpreter::Interpreter(const GcOptions& options)
+    : heap_(options), id_(next_interpreter_id.fetch_add(1, std::memory_order_relaxed)) {
+  HeapScope heap_scope(&heap_);
+  globals_ = std::make_shared<Environment>();
+  for (auto& pair : BuiltInTable) {
+    builtins_.emplace(pair.first, std::make_shared<BuiltInObject>(pair.second));
+  }
+  for (auto& pair : ExtensionBuiltIns()) {
+    builtins_.emplace(pair.first, std::make_shared<BuiltInObject>(pair.second));
+  }
+}
+
+Interpreter::~Interpreter() {
+  // Tasks still running, say blocked on a channel nobody else uses, stop
+  // at their next call or wakeup; the heap waits for them.
+  closing_.store(true, std::memory_order_relaxed);
+}
+
+std::shared_ptr<Program> Interpreter::Parse(const std::string& source, std::vector<std::string>* errors) const {
+  Lexer lexer(source);
+  Parser parser(&lexer, &builtins_);
+  std::shared_ptr<Program> program = parser.ParseProgram();
+  if (!parser.Errors().empty()) {
+    *errors = parser.Errors();
+    return nullptr;
+  }
+  return program;
+}
+
+std::shared_ptr<Object> Interpreter::Run(const std::shared_ptr<Program>& program,
+                                         const std::function<void(const std::shared_ptr<Object>&)>& each) {
+  HeapScope heap_scope(&heap_);
+  std::shared_ptr<Budget> budget = std::make_shared<Budget>(budget_, &closing_);
+  BudgetScope budget_scope(budget.get());
+  return program->Eval(globals_, each);
+}
+
+std::shared_ptr<Object> Interpreter::Eval(const std::string& source) {
+  std::vector<std::string> errors;
+  std::shared_ptr<Program> program = Parse(source, &errors);
+  if (program == nullptr) {
+    std::string message;
+    for (auto& error : errors) {
+      if (!message.empty()) {
+        message += "\n";
+      }
+      message += error;
+    }
+    return std::make_shared<ErrorObject>(message);
+  }
+  return Run(program);
+}
+
+std::shared_ptr<const Script> Interpreter::Compile(const std::string& source,
+                                                   std::vector<std::string>* errors) const {
+  std::shared_ptr<Program> program = Parse(source, errors);
+  if (program == nullptr) {
+    return nullptr;
+  }
+  return std::make_shared<Script>(std::move(program), id_);
+}
+
+Value Interpreter::Call(const Script& script, const Inputs& inputs) {
+  if (script.interpreter() != id_) {
+    return Value(std::make_shared<ErrorObject>("script was compiled by another interpreter"));
+  }
+  HeapScope heap_scope(&heap_);
+  std::shared_ptr<Budget> budget = std::make_shared<Budget>(budget_, &closing_);
+  BudgetScope budget_scope(budget.get());
+  std::shared_ptr<Environment> env = std::make_shared<Environment>(globals_);
+  const std::unordered_map<std::string, Symbol>& names = script.program()->names;
+  for (auto& input : inputs) {
+    // A name the script never mentions could not be read anyway.
+    auto iter = names.find(input.first);
+    if (iter != names.end()) {
+      env->Set(iter->second, input.second.object());
+    }
+  }
+  return Value(script.program()->Eval(env));
+}
+
+void Interpreter::Bind(const std::string& name, std::shared_ptr<Object> value) {
+  // Our own scopes are reachable from globals_ anyway; the root is for the
+  // ones other interpreters' heaps would otherwise collect.
+  std::shared_ptr<HostRoot> root = HostRoot::Make(value);
+  if (root != nullptr) {
+    bound_.push_back(std::move(root));
+  }
+  globals_->Set(name, std::move(value));
+}
+
+bool Interpreter::Define(const std::string& name, const BuiltInFnType& fn) {
+  return builtins_.emplace(name, std::make_shared<BuiltInObject>(fn)).second;
+}
+
+std::string Interpreter::SaveSnapshot(const std::string& path) const {
+  return ::SaveSnapshot(globals_, builtins_, path);
+}
+
+std::string Interpreter::LoadSnapshot(const std::string& path) {
+  HeapScope heap_scope(&heap_);
+  return ::LoadSnapshot(path, builtins_, globals_);
+}
@@ -0,0 +1,99 @@
+#ifndef SRC_INTERPRETER_H_
+#define SRC_INTERPRETER_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "budget.h"
+#include "gc.h"
+#include "script.h"
+
+// An isolated interpreter: its own heap, global environment and builtin
+// bindings. Interpreters share no mutable state, so any number of them can
+// run at once on different threads. A single interpreter must only be used
+// by one thread at a time, though not always the same one.
+//
+// What is shared process-wide is immutable once created: the symbol and
+// interned string tables, the core builtins and loaded extensions (which
+// must be loaded before the first interpreter is created), and the thread
+// pool behind the parallel builtins.
+class Interpreter {
+ public:
+  explicit Interpreter(const GcOptions& options = GcOptions());
+  // Cancels the evaluations of tasks that are still running, then waits
+  // for them.
+  ~Interpreter();
+
+  Interpreter(const Interpreter&) = delete;
+  Interpreter& operator=(const Interpreter&) = delete;
+
+  // Parses source against this interpreter's builtins, so the program is
+  // only for this interpreter to run. Returns nullptr and fills *errors if
+  // it does not parse.
+  std::shared_ptr<Program> Parse(const std::string& source, std::vector<std::string>* errors) const;
+
+  // Evaluates a program in the global environment. Bindings persist across
+  // calls. each, if set, sees the value of every top-level statement.
+  std::shared_ptr<Object> Run(const std::shared_ptr<Program>& program,
+                              const std::function<void(const std::shared_ptr<Object>&)>& each = nullptr);
+
+  // Parses and runs source. Parse errors are returned as an error object.
+  std::shared_ptr<Object> Eval(const std::string& source);
+
+  // Parses source once for any number of Calls. Returns nullptr and fills
+  // *errors if it does not parse.
+  std::shared_ptr<const Script> Compile(const std::string& source, std::vector<std::string>* errors) const;
+
+  // Runs a compiled script with inputs bound in a scope of its own, inside
+  // the global one: inputs shadow globals and builtins, and the script's
+  // let bindings are gone after the call. A script compiled by another
+  // interpreter gives an error.
+  Value Call(const Script& script, const Inputs& inputs = Inputs());
+
+  // Binds a global, as let would. This is how a host hands several
+  // interpreters the same channel. A closure of another interpreter keeps
+  // working while both interpreters live.
+  void Bind(const std::string& name, std::shared_ptr<Object> value);
+
+  // Binds a host function for scripts parsed afterwards. Returns false if
+  // the name is already a builtin.
+  bool Define(const std::string& name, const BuiltInFnType& fn);
+
+  // Limits every later Run, Eval and Call, each of which starts with a
+  // fresh budget. Exceeding it makes the evaluation return an error.
+  void SetBudget(const BudgetOptions& options) { budget_ = options; }
+
+  // Writes the globals to a snapshot file, see snapshot.h. Returns an empty
+  // string on success.
+  std::string SaveSnapshot(const std::string& path) const;
+
+  // Adds the globals saved in a snapshot file. Returns an empty string on
+  // success.
+  std::string LoadSnapshot(const std::string& path);
+
+  const std::shared_ptr<Environment>& globals() const { return globals_; }
+  const Heap& heap() const { return heap_; }
+  const BuiltInBindings& builtins() const { return builtins_; }
+  // Unique for the life of the process.
+  uint64_t id() const { return id_; }
+
+ private:
+  // Set on destruction to cancel every budget of this interpreter. It
+  // outlives the heap, which waits for tasks still using it.
+  std::atomic<bool> closing_{false};
+  // Declared before the globals so the global environment is gone before
+  // the heap.
+  Heap heap_;
+  std::shared_ptr<Environment> globals_;
+  BuiltInBindings builtins_;
+  BudgetOptions budget_;
+  const uint64_t id_;
+  // Roots for bound objects whose scopes other heaps manage.
+  std::vector<std::shared_ptr<HostRoot>> bound_;
+};
+
+#endif  // SRC_INTERPRETER_H_
@@ -0,0 +1,782 @@
+#include "builtins.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "ast.h"
+
+// json_parse works in two stages, after simdjson. The first classifies the
+// input 64 bytes at a time into bitmasks (with SSE2 where available) and
+// records the offsets of every structural character outside strings and of
+// every opening quote, rejecting unescaped control characters in strings on
+// the way. The second walks that index; it never scans for
+// delimiters byte by byte, and the scalars between index entries are parsed
+// in place. Object keys are shared within a parse, so a million records
+// share one string object per distinct key.
+//
+// json_stringify measures its output first and writes it into one buffer
+// of exactly that size.
+
+namespace {
+
+const int kMaxDepth = 1024;
+
+struct BlockMasks {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t structural;
+  // Bytes below 0x20, which strings must escape.
+  uint64_t control;
+};
+
+#ifdef __SSE2__
+uint64_t MatchMask(const __m128i chunks[4], char c) {
+  __m128i needle = _mm_set1_epi8(c);
+  uint64_t ret = 0;
+  for (int i = 0; i < 4; ++i) {
+    ret |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle)))) << (16 * i);
+  }
+  return ret;
+}
+
+BlockMasks Classify(const char* block) {
+  __m128i chunks[4];
+  for (int i = 0; i < 4; ++i) {
+    chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+  }
+  BlockMasks ret;
+  ret.quote = MatchMask(chunks, '"');
+  ret.backslash = MatchMask(chunks, '\\');
+  ret.structural = MatchMask(chunks, '{') | MatchMask(chunks, '}') | MatchMask(chunks, '[') |
+                   MatchMask(chunks, ']') | MatchMask(chunks, ':') | MatchMask(chunks, ',');
+  ret.control = 0;
+  __m128i limit = _mm_set1_epi8(0x1F);
+  for (int i = 0; i < 4; ++i) {
+    __m128i below = _mm_cmpeq_epi8(_mm_min_epu8(chunks[i], limit), chunks[i]);
+    ret.control |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(below))) << (16 * i);
+  }
+  return ret;
+}
+#else
+BlockMasks Classify(const char* block) {
+  BlockMasks ret = {0, 0, 0, 0};
+  for (int i = 0; i < 64; ++i) {
+    uint64_t bit = static_cast<uint64_t>(1) << i;
+    switch (block[i]) {
+    case '"': ret.quote |= bit; break;
+    case '\\': ret.backslash |= bit; break;
+    case '{': case '}': case '[': case ']': case ':': case ',': ret.structural |= bit; break;
+    default:
+      if (static_cast<unsigned char>(block[i]) < 0x20) {
+        ret.control |= bit;
+      }
+      break;
+    }
+  }
+  return ret;
+}
+#endif
+
+// Returns the mask of characters preceded by an odd run of backslashes.
+// Escapes are rare, so this walks the backslashes one by one.
+uint64_t EscapedMask(uint64_t backslash, uint64_t* carry) {
+  uint64_t escaped = *carry;
+  *carry = 0;
+  while (backslash != 0) {
+    int i = __builtin_ctzll(backslash);
+    backslash &= backslash - 1;
+    if ((escaped >> i) & 1) {
+      continue;
+    }
+    if (i == 63) {
+      *carry = 1;
+    } else {
+      escaped |= static_cast<uint64_t>(1) << (i + 1);
+    }
+  }
+  return escaped;
+}
+
+// Sets every bit from an opening quote up to (not including) its closing
+// quote.
+uint64_t PrefixXor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Stage one. Returns an error if a string is left open or holds an
+// unescaped control character, or an empty string.
+std::string BuildIndex(const char* text, size_t size, std::vector<uint32_t>* index) {
+  uint64_t escape_carry = 0;
+  uint64_t in_string_carry = 0;
+  char padded[64];
+  for (size_t base = 0; base < size; base += 64) {
+    const char* block = text + base;
+    if (size - base < 64) {
+      std::memset(padded, ' ', sizeof(padded));
+      std::memcpy(padded, block, size - base);
+      block = padded;
+    }
+    BlockMasks masks = Classify(block);
+    uint64_t quote = masks.quote;
+    if (masks.backslash != 0 || escape_carry != 0) {
+      quote &= ~EscapedMask(masks.backslash, &escape_carry);
+    }
+    uint64_t in_string = PrefixXor(quote) ^ in_string_carry;
+    in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+    if ((masks.control & in_string) != 0) {
+      return "control character in string at offset " +
+             std::to_string(base + __builtin_ctzll(masks.control & in_string));
+    }
+    uint64_t bits = (masks.structural & ~in_string) | (quote & in_string);
+    while (bits != 0) {
+      index->push_back(static_cast<uint32_t>(base + __builtin_ctzll(bits)));
+      bits &= bits - 1;
+    }
+  }
+  return in_string_carry == 0 ? std::string() : "unterminated string";
+}
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Whether token follows JSON's number grammar: an optional minus, an
+// integer part without leading zeros, then optionally a fraction and an
+// exponent, each with at least one digit. from_chars alone would also
+// take ".5", "1." and "inf".
+bool IsJsonNumber(std::string_view token) {
+  size_t i = 0;
+  if (i < token.size() && token[i] == '-') {
+    ++i;
+  }
+  if (i == token.size() || !IsDigit(token[i])) {
+    return false;
+  }
+  if (token[i++] != '0') {
+    while (i < token.size() && IsDigit(token[i])) {
+      ++i;
+    }
+  }
+  if (i < token.size() && token[i] == '.') {
+    if (++i == token.size() || !IsDigit(token[i])) {
+      return false;
+    }
+    while (i < token.size() && IsDigit(token[i])) {
+      ++i;
+    }
+  }
+  if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+    ++i;
+    if (i < token.size() && (token[i] == '+' || token[i] == '-')) {
+      ++i;
+    }
+    if (i == token.size() || !IsDigit(token[i])) {
+      return false;
+    }
+    while (i < token.size() && IsDigit(token[i])) {
+      ++i;
+    }
+  }
+  return i == token.size();
+}
+
+void AppendUtf8(uint32_t code, std::string* out) {
+  if (code < 0x80) {
+    out->push_back(static_cast<char>(code));
+  } else if (code < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  } else if (code < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (code >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  }
+}
+
+// Stage two.
+class JsonParser {
+ public:
+  JsonParser(const char* text, size_t size) : text_(text), size_(size), pos_(0), next_(0) {}
+
+  std::shared_ptr<Object> Parse() {
+    if (size_ > UINT32_MAX) {
+      return error("input too large");
+    }
+    index_.reserve(size_ / 8);
+    std::string message = BuildIndex(text_, size_, &index_);
+    if (!message.empty()) {
+      return error(message);
+    }
+    std::shared_ptr<Object> ret;
+    std::shared_ptr<Object> err = parseValue(0, &ret);
+    if (err != nullptr) {
+      return err;
+    }
+    if (skipSpace(pos_) != size_) {
+      return error("unexpected trailing input at offset " + std::to_string(skipSpace(pos_)));
+    }
+    return ret;
+  }
+
+ private:
+  std::shared_ptr<Object> error(const std::string& message) const {
+    return std::make_shared<ErrorObject>("json_parse: " + message);
+  }
+
+  std::shared_ptr<Object> unexpected(size_t pos) const {
+    if (pos >= size_) {
+      return error("unexpected end of input");
+    }
+    return error(std::string("unexpected '") + text_[pos] + "' at offset " + std::to_string(pos));
+  }
+
+  size_t skipSpace(size_t pos) const {
+    while (pos < size_ && IsSpace(text_[pos])) {
+      ++pos;
+    }
+    return pos;
+  }
+
+  // Consumes the structural character c if it is the next token.
+  bool consume(char c) {
+    size_t pos = skipSpace(pos_);
+    if (next_ < index_.size() && index_[next_] == pos && text_[pos] == c) {
+      ++next_;
+      pos_ = pos + 1;
+      return true;
+    }
+    return false;
+  }
+
+  std::shared_ptr<Object> parseValue(int depth, std::shared_ptr<Object>* out) {
+    if (depth > kMaxDepth) {
+      return error("nesting too deep");
+    }
+    size_t pos = skipSpace(pos_);
+    if (pos >= size_) {
+      return unexpected(pos);
+    }
+    bool indexed = next_ < index_.size() && index_[next_] == pos;
+    if (!indexed && (text_[pos] == '{' || text_[pos] == '[' || text_[pos] == '"')) {
+      return unexpected(pos);
+    }
+    switch (text_[pos]) {
+    case '{':
+      ++next_;
+      pos_ = pos + 1;
+      return parseObject(depth, out);
+    case '[':
+      ++next_;
+      pos_ = pos + 1;
+      return parseArray(depth, out);
+    case '"': {
+      ++next_;
+      std::string value;
+      std::shared_ptr<Object> err = parseString(pos, &value);
+      if (err != nullptr) {
+        return err;
+      }
+      *out = std::make_shared<StringObject>(std::move(value));
+      return nullptr;
+    }
+    default:
+      if (indexed) {
+        return unexpected(pos);
+      }
+      return parseScalar(pos, out);
+    }
+  }
+
+  std::shared_ptr<Object> parseObject(int depth, std::shared_ptr<Object>* out) {
+    std::shared_ptr<HashObject> ret = std::make_shared<HashObject>();
+    if (!consume('}')) {
+      do {
+        size_t pos = skipSpace(pos_);
+        if (pos >= size_ || text_[pos] != '"' || next_ >= index_.size() || index_[next_] != pos) {
+          return unexpected(pos);
+        }
+        ++next_;
+        std::shared_ptr<StringObject> key;
+        std::shared_ptr<Object> err = parseKey(pos, &key);
+        if (err != nullptr) {
+          return err;
+        }
+        if (!consume(':')) {
+          return unexpected(skipSpace(pos_));
+        }
+        std::shared_ptr<Object> value;
+        err = parseValue(depth + 1, &value);
+        if (err != nullptr) {
+          return err;
+        }
+        ret->table.Set(std::move(key), std::move(value));
+      } while (consume(','));
+      if (!consume('}')) {
+        return unexpected(skipSpace(pos_));
+      }
+    }
+    *out = ret;
+    return nullptr;
+  }
+
+  std::shared_ptr<Object> parseArray(int depth, std::shared_ptr<Object>* out) {
+    std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+    if (!consume(']')) {
+      do {
+        std::shared_ptr<Object> value;
+        std::shared_ptr<Object> err = parseValue(depth + 1, &value);
+        if (err != nullptr) {
+          return err;
+        }
+        ret->Append(std::move(value));
+      } while (consume(','));
+      if (!consume(']')) {
+        return unexpected(skipSpace(pos_));
+      }
+    }
+    *out = ret;
+    return nullptr;
+  }
+
+  // Finds the closing quote of the string opening at pos and sets *raw to
+  // its undecoded contents and whether they contain escapes.
+  void scanString(size_t pos, std::string_view* raw, bool* escaped) {
+    const char* begin = text_ + pos + 1;
+    const char* end = text_ + size_;
+    const char* quote = begin;
+    while (true) {
+      // Stage one guarantees a closing quote.
+      quote = static_cast<const char*>(std::memchr(quote, '"', end - quote));
+      const char* backslash = quote;
+      while (backslash > begin && backslash[-1] == '\\') {
+        --backslash;
+      }
+      if ((quote - backslash) % 2 == 0) {
+        break;
+      }
+      ++quote;
+    }
+    *raw = std::string_view(begin, quote - begin);
+    *escaped = std::memchr(begin, '\\', quote - begin) != nullptr;
+    pos_ = quote - text_ + 1;
+  }
+
+  std::shared_ptr<Object> parseString(size_t pos, std::string* out) {
+    std::string_view raw;
+    bool escaped;
+    scanString(pos, &raw, &escaped);
+    if (!escaped) {
+      out->assign(raw.data(), raw.size());
+      return nullptr;
+    }
+    return unescape(raw, pos, out);
+  }
+
+  std::shared_ptr<Object> parseKey(size_t pos, std::shared_ptr<StringObject>* out) {
+    std::string_view raw;
+    bool escaped;
+    scanString(pos, &raw, &escaped);
+    std::string value;
+    if (escaped) {
+      std::shared_ptr<Object> err = unescape(raw, pos, &value);
+      if (err != nullptr) {
+        return err;
+      }
+      raw = value;
+    }
+    auto iter = keys_.find(raw);
+    if (iter != keys_.end()) {
+      *out = iter->second;
+      return nullptr;
+    }
+    *out = std::make_shared<StringObject>(std::string(raw));
+    keys_.emplace((*out)->Value(), *out);
+    return nullptr;
+  }
+
+  std::shared_ptr<Object> unescape(std::string_view raw, size_t pos, std::string* out) {
+    out->reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+      if (raw[i] != '\\') {
+        out->push_back(raw[i]);
+        continue;
+      }
+      if (++i == raw.size()) {
+        break;
+      }
+      switch (raw[i]) {
+      case '"': out->push_back('"'); break;
+      case '\\': out->push_back('\\'); break;
+      case '/': out->push_back('/'); break;
+      case 'b': out->push_back('\b'); break;
+      case 'f': out->push_back('\f'); break;
+      case 'n': out->push_back('\n'); break;
+      case 'r': out->push_back('\r'); break;
+      case 't': out->push_back('\t'); break;
+      case 'u': {
+        uint32_t code;
+        if (!parseHex4(raw, i + 1, &code)) {
+          return error("invalid \\u escape in string at offset " + std::to_string(pos));
+        }
+        i += 4;
+        if (code >= 0xD800 && code < 0xDC00 && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u') {
+          uint32_t low;
+          if (parseHex4(raw, i + 3, &low) && low >= 0xDC00 && low < 0xE000) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            i += 6;
+          }
+        }
+        AppendUtf8(code, out);
+        break;
+      }
+      default:
+        return error("invalid escape in string at offset " + std::to_string(pos));
+      }
+    }
+    return nullptr;
+  }
+
+  static bool parseHex4(std::string_view raw, size_t i, uint32_t* out) {
+    if (i + 4 > raw.size()) {
+      return false;
+    }
+    *out = 0;
+    for (size_t j = i; j < i + 4; ++j) {
+      char c = raw[j];
+      uint32_t digit;
+      if (c >= '0' && c <= '9') {
+        digit = c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        digit = c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        digit = c - 'A' + 10;
+      } else {
+        return false;
+      }
+      *out = *out * 16 + digit;
+    }
+    return true;
+  }
+
+  // Numbers, true, false and null run up to the next structural character.
+  std::shared_ptr<Object> parseScalar(size_t pos, std::shared_ptr<Object>* out) {
+    size_t end = next_ < index_.size() ? index_[next_] : size_;
+    while (end > pos && IsSpace(text_[end - 1])) {
+      --end;
+    }
+    std::string_view token(text_ + pos, end - pos);
+    pos_ = end;
+    if (token == "true" || token == "false") {
+      *out = std::make_shared<BooleanObject>(token == "true");
+      return nullptr;
+    }
+    if (token == "null") {
+      *out = std::make_shared<NullObject>();
+      return nullptr;
+    }
+    return parseNumber(token, pos, out);
+  }
+
+  std::shared_ptr<Object> parseNumber(std::string_view token, size_t pos, std::shared_ptr<Object>* out) {
+    bool negative = !token.empty() && token[0] == '-';
+    size_t i = negative ? 1 : 0;
+    if (i == token.size() || (token[i] == '0' && i + 1 < token.size() && token[i + 1] >= '0' && token[i + 1] <= '9')) {
+      return error("invalid value at offset " + std::to_string(pos));
+    }
+    uint64_t magnitude = 0;
+    for (; i < token.size(); ++i) {
+      char c = token[i];
+      if (c == '.' || c == 'e' || c == 'E') {
+        return parseFloat(token, pos, out);
+      }
+      if (c < '0' || c > '9') {
+        return error("invalid value at offset " + std::to_string(pos));
+      }
+      uint64_t digit = c - '0';
+      if (magnitude > (static_cast<uint64_t>(INT64_MAX) + 1 - digit) / 10) {
+        return error("integer out of range at offset " + std::to_string(pos));
+      }
+      magnitude = magnitude * 10 + digit;
+    }
+    if (!negative && magnitude > static_cast<uint64_t>(INT64_MAX)) {
+      return error("integer out of range at offset " + std::to_string(pos));
+    }
+    *out = std::make_shared<IntegerObject>(negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude));
+    return nullptr;
+  }
+
+  std::shared_ptr<Object> parseFloat(std::string_view token, size_t pos, std::shared_ptr<Object>* out) {
+    if (!IsJsonNumber(token)) {
+      return error("invalid number at offset " + std::to_string(pos));
+    }
+    double value;
+    std::from_chars_result result = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (result.ec != std::errc() || result.ptr != token.data() + token.size()) {
+      return error("invalid number at offset " + std::to_string(pos));
+    }
+    *out = std::make_shared<FloatObject>(value);
+    return nullptr;
+  }
+
+  const char* text_;
+  size_t size_;
+  std::vector<uint32_t> index_;
+  // Text before pos_ and index entries before next_ are consumed.
+  size_t pos_;
+  size_t next_;
+  // Keys seen so far, by their value. Unlike symbols, they are freed with
+  // the parsed data, so parsing ever new keys (ids, say) does not leak.
+  std::unordered_map<std::string_view, std::shared_ptr<StringObject>> keys_;
+};
+
+// Bytes the escaped form of value takes, without the quotes.
+size_t EscapedSize(std::string_view value) {
+  size_t ret = value.size();
+  for (char c : value) {
+    unsigned char u = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t' || c == '\b' || c == '\f') {
+      ret += 1;
+    } else if (u < 0x20) {
+      ret += 5;
+    }
+  }
+  return ret;
+}
+
+void AppendEscaped(std::string_view value, std::string* out) {
+  static const char kHex[] = "0123456789abcdef";
+  size_t begin = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    unsigned char u = static_cast<unsigned char>(value[i]);
+    if (u >= 0x20 && u != '"' && u != '\\') {
+      continue;
+    }
+    out->append(value.data() + begin, i - begin);
+    begin = i + 1;
+    switch (u) {
+    case '"': out->append("\\\""); break;
+    case '\\': out->append("\\\\"); break;
+    case '\n': out->append("\\n"); break;
+    case '\r': out->append("\\r"); break;
+    case '\t': out->append("\\t"); break;
+    case '\b': out->append("\\b"); break;
+    case '\f': out->append("\\f"); break;
+    default:
+      out->append("\\u00");
+      out->push_back(kHex[u >> 4]);
+      out->push_back(kHex[u & 0xF]);
+      break;
+    }
+  }
+  out->append(value.data() + begin, value.size() - begin);
+}
+
+size_t DigitCount(int64_t value) {
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+  size_t ret = value < 0 ? 2 : 1;
+  while (magnitude >= 10) {
+    magnitude /= 10;
+    ++ret;
+  }
+  return ret;
+}
+
+class JsonWriter {
+ public:
+  // Returns an error object if obj has no JSON form.
+  std::shared_ptr<Object> Write(Object* obj, std::string* out) {
+    size_t size = 0;
+    std::shared_ptr<Object> err = measure(obj, &size);
+    if (err != nullptr) {
+      return err;
+    }
+    out->reserve(size);
+    write(obj, out);
+    return nullptr;
+  }
+
+ private:
+  static std::shared_ptr<Object> unsupported(Object* obj) {
+    return std::make_shared<ErrorObject>("json_stringify: cannot serialize " + ObjectTypeToString(obj->Type()));
+  }
+
+  // Keys must be strings in JSON; integer and boolean keys are quoted.
+  static bool isKey(Object* key) {
+    ObjectType type = key->Type();
+    return type == ObjectType::kString || type == ObjectType::kInteger || type == ObjectType::kBoolean;
+  }
+
+  std::shared_ptr<Object> measure(Object* obj, size_t* size) {
+    switch (obj->Type()) {
+    case ObjectType::kInteger:
+      *size += DigitCount(static_cast<IntegerObject*>(obj)->value);
+      return nullptr;
+    case ObjectType::kFloat: {
+      double value = static_cast<FloatObject*>(obj)->value;
+      if (!std::isfinite(value)) {
+        return std::make_shared<ErrorObject>("json_stringify: cannot serialize " + FormatFloat(value));
+      }
+      *size += FormatFloat(value).size();
+      return nullptr;
+    }
+    case ObjectType::kBoolean:
+      *size += static_cast<BooleanObject*>(obj)->value ? 4 : 5;
+      return nullptr;
+    case ObjectType::kNull:
+      *size += 4;
+      return nullptr;
+    case ObjectType::kString:
+      *size += EscapedSize(static_cast<StringObject*>(obj)->View()) + 2;
+      return nullptr;
+    case ObjectType::kArray: {
+      ArrayObject* arr = static_cast<ArrayObject*>(obj);
+      *size += 2 + (arr->Size() > 0 ? arr->Size() - 1 : 0);
+      if (arr->IsInts()) {
+        for (size_t i = 0; i < arr->Size(); ++i) {
+          *size += DigitCount(arr->ints[i]);
+        }
+        return nullptr;
+      }
+      std::shared_ptr<Object> err;
+      arr->ForEach([&](const std::shared_ptr<Object>& elem) {
+        if (err == nullptr) {
+          err = measure(elem.get(), size);
+        }
+      });
+      return err;
+    }
+    case ObjectType::kHash: {
+      ObjectTable& table = static_cast<HashObject*>(obj)->table;
+      *size += 2 + (table.size() > 0 ? table.size() - 1 : 0);
+      for (auto& entry : table) {
+        if (!isKey(entry.key.get())) {
+          return std::make_shared<ErrorObject>("json_stringify: cannot use " + ObjectTypeToString(entry.key->Type()) + " as a key");
+        }
+        std::shared_ptr<Object> err = measure(entry.key.get(), size);
+        if (err != nullptr) {
+          return err;
+        }
+        if (entry.key->Type() != ObjectType::kString) {
+          *size += 2;
+        }
+        *size += 1;
+        err = measure(entry.value.get(), size);
+        if (err != nullptr) {
+          return err;
+        }
+      }
+      return nullptr;
+    }
+    default:
+      return unsupported(obj);
+    }
+  }
+
+  void write(Object* obj, std::string* out) {
+    switch (obj->Type()) {
+    case ObjectType::kInteger:
+      out->append(std::to_string(static_cast<IntegerObject*>(obj)->value));
+      break;
+    case ObjectType::kFloat:
+      out->append(FormatFloat(static_cast<FloatObject*>(obj)->value));
+      break;
+    case ObjectType::kBoolean:
+      out->append(static_cast<BooleanObject*>(obj)->value ? "true" : "false");
+      break;
+    case ObjectType::kNull:
+      out->append("null");
+      break;
+    case ObjectType::kString:
+      out->push_back('"');
+      AppendEscaped(static_cast<StringObject*>(obj)->View(), out);
+      out->push_back('"');
+      break;
+    case ObjectType::kArray: {
+      ArrayObject* arr = static_cast<ArrayObject*>(obj);
+      out->push_back('[');
+      bool first = true;
+      arr->ForEach([&](const std::shared_ptr<Object>& elem) {
+        if (!first) {
+          out->push_back(',');
+        }
+        first = false;
+        write(elem.get(), out);
+      });
+      out->push_back(']');
+      break;
+    }
+    case ObjectType::kHash: {
+      out->push_back('{');
+      bool first = true;
+      for (auto& entry : static_cast<HashObject*>(obj)->table) {
+        if (!first) {
+          out->push_back(',');
+        }
+        first = false;
+        if (entry.key->Type() == ObjectType::kString) {
+          write(entry.key.get(), out);
+        } else {
+          out->push_back('"');
+          write(entry.key.get(), out);
+          out->push_back('"');
+        }
+        out->push_back(':');
+        write(entry.value.get(), out);
+      }
+      out->push_back('}');
+      break;
+    }
+    default:
+      break;
+    }
+  }
+};
+
+}  // namespace
+
+std::shared_ptr<Object> BuiltInJsonParse(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 1) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (args[0]->Type() != ObjectType::kString) {
+    return std::make_shared<ErrorObject>("argument to json_parse must be String, got " + ObjectTypeToString(args[0]->Type()));
+  }
+  std::string_view text = static_cast<StringObject*>(args[0].get())->View();
+  return JsonParser(text.data(), text.size()).Parse();
+}
+
+std::shared_ptr<Object> BuiltInJsonStringify(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 1) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::string out;
+  std::shared_ptr<Object> err = JsonWriter().Write(args[0].get(), &out);
+  if (err != nullptr) {
+    return err;
+  }
+  return std::make_shared<StringObject>(std::move(out));
+}
@@ -7,13 +7,15 @@
 
 class Lexer {
  public:
-  Lexer(const std::string& input) : input_(input), readPosition_(0) {
+  Lexer(const std::string& input) : input_(input), readPosition_(0), ch_(0), line_(1), lineStart_(0) {
     readChar();
   }
 
   Token NextToken() {
     Token tok;
     skipWhiteSpaces();
+    tok.line = line_;
+    tok.column = position_ - lineStart_ + 1;
     auto cm_iter = CharTokenTypeMap.find(ch_);
     if (cm_iter != CharTokenTypeMap.end()) {
       tok.type = cm_iter->second;
@@ -44,8 +46,7 @@ class Lexer {
         tok.type = TokenType::kIdent;
       }
     } else if (isDigit(ch_)) {
-      tok.type = TokenType::kInt;
-      tok.literal = readNumber();
+      tok.literal = readNumber(&tok.type);
     } else if (ch_ == '"') {
       tok.type = TokenType::kString;
       tok.literal = readString();
@@ -56,13 +57,18 @@ class Lexer {
       tok.type = TokenType::kEOF;
     } else {
       tok.type = TokenType::kIllegal;
-      tok.literal = std::string(ch_, 1);
+      tok.literal = std::string(1, ch_);
+      readChar();
     }
     return tok;
   }
 
  private:
   void readChar() {
+    if (ch_ == '\n') {
+      ++line_;
+      lineStart_ = readPosition_;
+    }
     if (readPosition_ >= input_.length()) {
       ch_ = 0;
     } else {
@@ -96,14 +102,39 @@ class Lexer {
     return input_.substr(begin, position_ - begin);
   }
 
-  std::string readNumber() {
+  // Digits, then optionally a fraction and an exponent, which make the
+  // number a float: 12, 1.5, 2e10, 6.02e-23.
+  std::string readNumber(TokenType* type) {
     int begin = position_;
-    while (isDigit(ch_)) {
+    *type = TokenType::kInt;
+    readDigits();
+    if (ch_ == '.' && isDigit(peekChar())) {
+      *type = TokenType::kFloat;
       readChar();
+      readDigits();
+    }
+    if (ch_ == 'e' || ch_ == 'E') {
+      size_t digits = readPosition_;
+      if (digits < input_.length() && (input_[digits] == '+' || input_[digits] == '-')) {
+        ++digits;
+      }
+      if (digits < input_.length() && isDigit(input_[digits])) {
+        *type = TokenType::kFloat;
+        while (static_cast<size_t>(position_) < digits) {
+          readChar();
+        }
+        readDigits();
+      }
     }
     return input_.substr(begin, position_ - begin);
   }
 
+  void readDigits() {
+    while (isDigit(ch_)) {
+      readChar();
+    }
+  }
+
   std::string readString() {
     int begin = position_ + 1;
     while (true) {
@@ -125,6 +156,8 @@ class Lexer {
   int position_;
   int readPosition_;
   char ch_;
+  int line_;
+  int lineStart_;
 };
 
 #endif  // SRC_LEXER_LEXER_H_
\ No newline at end of file
@@ -10,6 +10,7 @@ enum class TokenType {
   kEOF,
   kIdent,
   kInt,
+  kFloat,
   kAssign,
   kPlus,
   kMinus,
@@ -47,6 +48,8 @@ inline std::string TokenTypeToName(TokenType type) {
     return "Identifier";
   case TokenType::kInt:
     return "Integer";
+  case TokenType::kFloat:
+    return "Float";
   case TokenType::kAssign:
     return "Assign";
   case TokenType::kPlus:
@@ -139,6 +142,9 @@ static const std::map<std::string, TokenType> TokenTypeMap = {
 struct Token {
   TokenType type = TokenType::kIllegal;
   std::string literal;
+  // Where the token starts, both from 1; 0 if unknown.
+  int line = 0;
+  int column = 0;
 };
 
 #endif //SRC_LEXER_TOKEN_H_
\ No newline at end of file
@@ -1,5 +1,14 @@
 #include "object.h"
+
+#include <charconv>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 #include "ast.h"
+#include "builtins.h"
+#include "profiler.h"
+#include "thread_pool.h"
 
 std::string FunctionObject::Inspect() {
   std::string ret = "fn(";
@@ -13,6 +22,411 @@ std::string FunctionObject::Inspect() {
   return ret;
 }
 
+std::string FormatFloat(double value) {
+  char buffer[32];
+  char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+  std::string ret(buffer, end);
+  if (ret.find_first_of(".einf") == std::string::npos) {
+    ret += ".0";
+  }
+  return ret;
+}
+
+// Concatenations shorter than this are copied eagerly.
+static const size_t kMinRopeLength = 256;
+
+StringObject::~StringObject() {
+  // Release long rope chains iteratively so dropping them does not recurse
+  // once per concatenation.
+  std::vector<std::shared_ptr<StringObject>> pending;
+  if (left_ != nullptr) {
+    pending.push_back(std::move(left_));
+    pending.push_back(std::move(right_));
+  }
+  while (!pending.empty()) {
+    std::shared_ptr<StringObject> node = std::move(pending.back());
+    pending.pop_back();
+    if (node.use_count() == 1 && node->left_ != nullptr) {
+      pending.push_back(std::move(node->left_));
+      pending.push_back(std::move(node->right_));
+    }
+  }
+}
+
+void StringObject::Flatten() const {
+  std::call_once(flatten_once_, [this]() {
+    if (view_ != nullptr) {
+      value_.assign(view_, length_);
+      flat_.store(true, std::memory_order_release);
+      return;
+    }
+    ReserveBudget(length_);
+    std::string flat;
+    flat.reserve(length_);
+    std::vector<std::shared_ptr<StringObject>> stack = {std::atomic_load(&right_), std::atomic_load(&left_)};
+    while (!stack.empty()) {
+      std::shared_ptr<StringObject> node = std::move(stack.back());
+      stack.pop_back();
+      if (node->view_ != nullptr) {
+        flat.append(node->view_, node->length_);
+        continue;
+      }
+      if (node->flat_.load(std::memory_order_acquire)) {
+        flat += node->value_;
+        continue;
+      }
+      std::shared_ptr<StringObject> left = std::atomic_load(&node->left_);
+      std::shared_ptr<StringObject> right = std::atomic_load(&node->right_);
+      if (left == nullptr) {
+        // Another thread flattened the node in the meantime.
+        flat += node->Value();
+        continue;
+      }
+      stack.push_back(std::move(right));
+      stack.push_back(std::move(left));
+    }
+    value_ = std::move(flat);
+    flat_.store(true, std::memory_order_release);
+    std::atomic_store(&left_, std::shared_ptr<StringObject>());
+    std::atomic_store(&right_, std::shared_ptr<StringObject>());
+  });
+}
+
+std::shared_ptr<StringObject> StringLiterals::Get(const std::string& value) {
+  std::shared_ptr<StringObject>& ret = table_[value];
+  if (ret == nullptr) {
+    ret = std::make_shared<StringObject>(value);
+  }
+  return ret;
+}
+
+std::shared_ptr<StringObject> ConcatStrings(std::shared_ptr<StringObject> left,
+                                            std::shared_ptr<StringObject> right) {
+  if (left->Length() == 0) {
+    return right;
+  }
+  if (right->Length() == 0) {
+    return left;
+  }
+  if (left->Length() + right->Length() < kMinRopeLength) {
+    std::string flat(left->View());
+    flat += right->View();
+    return std::make_shared<StringObject>(std::move(flat));
+  }
+  return std::make_shared<StringObject>(left, right);
+}
+
+// Slices this short fit in std::string's inline buffer, so copying them
+// allocates nothing and does not keep the parent alive.
+static const size_t kMinSliceLength = 16;
+
+std::shared_ptr<StringObject> SliceString(const std::shared_ptr<StringObject>& str,
+                                          size_t pos, size_t length) {
+  if (pos == 0 && length == str->Length()) {
+    return str;
+  }
+  std::string_view value = str->View();
+  if (length < kMinSliceLength) {
+    return std::make_shared<StringObject>(std::string(value.substr(pos, length)));
+  }
+  // A flat string's value_ never changes again, so it can be viewed too.
+  std::shared_ptr<const void> owner = str->view_ != nullptr ? str->owner_ : str;
+  return std::make_shared<StringObject>(std::move(owner), value.data() + pos, length);
+}
+
+// The error of an allocation that failed, or that the budget refused.
+static std::shared_ptr<Object> OutOfMemory() {
+  Budget* budget = Budget::Current();
+  return std::make_shared<ErrorObject>(budget != nullptr && budget->Exhausted() ? budget->Error() : "out of memory");
+}
+
+// Function calls in progress on this thread.
+static thread_local size_t call_depth = 0;
+
+struct CallDepthScope {
+  CallDepthScope() { ++call_depth; }
+  ~CallDepthScope() { --call_depth; }
+};
+
+std::shared_ptr<Object> ApplyFunction(const std::shared_ptr<Object>& fn,
+                                      std::vector<std::shared_ptr<Object>> args) {
+  if (StackExhausted()) {
+    return std::make_shared<ErrorObject>("maximum call depth exceeded: stack exhausted after " +
+                                         std::to_string(call_depth) + " nested calls");
+  }
+  if (fn->Type() == ObjectType::kBuiltIn) {
+    ProfileScope profile_scope(fn.get());
+    BuiltInObject* builtin = static_cast<BuiltInObject*>(fn.get());
+    try {
+      if (builtin->native != nullptr) {
+        return builtin->native(ObjectSpan(args.data(), args.size()));
+      }
+      return builtin->fn(std::move(args));
+    } catch (const std::bad_alloc&) {
+      return OutOfMemory();
+    }
+  }
+  if (fn->Type() != ObjectType::kFunction) {
+    return std::make_shared<ErrorObject>("not a function: " + ObjectTypeToString(fn->Type()));
+  }
+  FunctionObject* function = static_cast<FunctionObject*>(fn.get());
+  if (args.size() != function->parameters.size()) {
+    return std::make_shared<ErrorObject>("wrong number of arguments: want=" +
+                                         std::to_string(function->parameters.size()) +
+                                         ", got=" + std::to_string(args.size()));
+  }
+  Budget* budget = Budget::Current();
+  if (budget != nullptr && !budget->Step()) {
+    return std::make_shared<ErrorObject>(budget->Error());
+  }
+  size_t max_depth = budget != nullptr ? budget->options().max_depth : 0;
+  if (max_depth != 0 && call_depth >= max_depth) {
+    return std::make_shared<ErrorObject>("maximum call depth of " + std::to_string(max_depth) + " exceeded");
+  }
+  CallDepthScope depth_scope;
+  ProfileScope profile_scope(fn.get());
+  std::shared_ptr<Environment> nested_env = std::make_shared<Environment>(function->env);
+  for (size_t i = 0; i < args.size(); ++i) {
+    nested_env->Set(function->parameters[i].symbol, std::move(args[i]));
+  }
+  std::shared_ptr<Object> ret;
+  try {
+    ret = function->body->Eval(nested_env);
+  } catch (const std::bad_alloc&) {
+    return OutOfMemory();
+  }
+  if (ret != nullptr && ret->Type() == ObjectType::kReturnValue) {
+    return static_cast<ReturnValueObject*>(ret.get())->value;
+  }
+  return ret;
+}
+
+std::shared_ptr<Object> SequenceObject::Run(const std::function<bool(std::shared_ptr<Object>)>& f) const {
+  for (auto& stage : stages) {
+    if (stage.kind == Stage::kTake && stage.count <= 0) {
+      return nullptr;
+    }
+  }
+  std::vector<int64_t> taken(stages.size(), 0);
+  std::unique_ptr<Cursor> cursor = source->Open();
+  std::shared_ptr<Object> value;
+  bool last = false;
+  while (!last && cursor->Next(&value)) {
+    if (value->Type() == ObjectType::kError) {
+      return value;
+    }
+    size_t i = 0;
+    for (; i < stages.size(); ++i) {
+      const Stage& stage = stages[i];
+      if (stage.kind == Stage::kTake) {
+        // Everything upstream of a satisfied take is done; this element
+        // still goes through the remaining stages.
+        last = last || ++taken[i] == stage.count;
+        continue;
+      }
+      std::shared_ptr<Object> ret = ApplyFunction(stage.fn, {value});
+      if (ret == nullptr) {
+        ret = std::make_shared<NullObject>();
+      }
+      if (ret->Type() == ObjectType::kError) {
+        return ret;
+      }
+      if (stage.kind == Stage::kMap) {
+        value = std::move(ret);
+      } else if (!IsTruthy(ret)) {
+        break;
+      }
+    }
+    if (i == stages.size() && !f(std::move(value))) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<TaskObject> TaskObject::Spawn(std::shared_ptr<Object> fn, std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<TaskObject> task = std::make_shared<TaskObject>(std::move(fn), std::move(args));
+  if (task->fn->Type() == ObjectType::kFunction) {
+    static_cast<FunctionObject*>(task->fn.get())->env->Share();
+  }
+  for (auto& arg : task->args) {
+    if (arg->Type() == ObjectType::kFunction) {
+      static_cast<FunctionObject*>(arg.get())->env->Share();
+    }
+  }
+  task->heap_ = Heap::Current();
+  if (Budget::Current() != nullptr) {
+    task->budget_ = Budget::Current()->weak_from_this().lock();
+  }
+  if (task->heap_ != nullptr) {
+    task->heap_->TaskStarted();
+  }
+  ThreadPool::Default().Submit([task]() mutable {
+    Heap* heap = task->heap_;
+    bool ran = task->run();
+    // Drop the pool's reference before telling the heap: if it is the last
+    // one, the task's closures and scopes go now, while the heap surely
+    // still exists.
+    task.reset();
+    if (heap != nullptr) {
+      if (ran) {
+        heap->TaskFinished();
+      }
+      heap->TaskReleased();
+    }
+  });
+  return task;
+}
+
+bool TaskObject::run() {
+  int expected = kPending;
+  if (!state_.compare_exchange_strong(expected, kRunning, std::memory_order_acq_rel)) {
+    return false;
+  }
+  {
+    HeapScope heap_scope(heap_);
+    BudgetScope budget_scope(budget_.get());
+    result_ = ApplyFunction(fn, args);
+    if (result_ == nullptr) {
+      result_ = std::make_shared<NullObject>();
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    state_.store(kDone, std::memory_order_release);
+  }
+  done_.notify_all();
+  return true;
+}
+
+std::shared_ptr<Object> TaskObject::Await() {
+  if (run() && heap_ != nullptr) {
+    // The awaiting evaluation still holds the task.
+    heap_->TaskFinished();
+  }
+  if (Done()) {
+    return result_;
+  }
+  if (ThreadPool::Default().BeginBlocking()) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this]() { return Done(); });
+    }
+    ThreadPool::Default().EndBlocking();
+  } else {
+    while (!Done()) {
+      std::this_thread::yield();
+    }
+  }
+  return result_;
+}
+
+// A blocked channel operation retries this often before it sleeps.
+static const int kChannelSpins = 64;
+// How often a sleeping channel operation checks whether its evaluation was
+// cancelled or ran out of time: nothing else may ever wake it.
+static const std::chrono::milliseconds kChannelPoll(10);
+
+static const char kTooManyBlocked[] = "too many threads blocked on channels";
+
+template <typename Ready>
+std::string ChannelObject::sleep(std::atomic<int>& waiters, Ready ready) {
+  // Lets the pool run tasks, such as the other side, in this thread's place.
+  if (!ThreadPool::Default().BeginBlocking()) {
+    return kTooManyBlocked;
+  }
+  Budget* budget = Budget::Current();
+  std::string error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters.fetch_add(1);
+    // Pairs with the fence in wake: either the other side sees this waiter,
+    // or ready() sees its progress.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!cv_.wait_for(lock, kChannelPoll, ready)) {
+      if (budget != nullptr && !budget->Check()) {
+        error = budget->Error();
+        break;
+      }
+    }
+    waiters.fetch_sub(1);
+  }
+  ThreadPool::Default().EndBlocking();
+  return error;
+}
+
+void ChannelObject::wake(std::atomic<int>& waiters) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_all();
+  }
+}
+
+std::string ChannelObject::Send(std::shared_ptr<Object> value) {
+  bool sent = false;
+  auto ready = [this, &value, &sent]() {
+    // Counted while pushing, so Recv does not report a closed channel
+    // drained while a value is still on its way in.
+    sending_.fetch_add(1);
+    sent = !closed_.load() && queue_.TryPush(value);
+    sending_.fetch_sub(1);
+    return sent || closed_.load(std::memory_order_acquire);
+  };
+  for (int spins = 0; !ready(); ++spins) {
+    if (spins < kChannelSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+    std::string error = sleep(blocked_senders_, ready);
+    if (!error.empty()) {
+      return error;
+    }
+    break;
+  }
+  if (!sent) {
+    return "send on closed channel";
+  }
+  wake(blocked_receivers_);
+  return "";
+}
+
+std::string ChannelObject::Recv(std::shared_ptr<Object>* value) {
+  value->reset();
+  auto ready = [this, value]() {
+    return queue_.TryPop(value) || closed_.load(std::memory_order_acquire);
+  };
+  for (int spins = 0; !ready(); ++spins) {
+    if (spins < kChannelSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+    std::string error = sleep(blocked_receivers_, ready);
+    if (!error.empty()) {
+      return error;
+    }
+    break;
+  }
+  // Closed: drain what was sent before, including by senders that saw the
+  // channel open just before it closed.
+  if (*value == nullptr) {
+    while (sending_.load() != 0) {
+      std::this_thread::yield();
+    }
+    queue_.TryPop(value);
+  }
+  if (*value != nullptr) {
+    wake(blocked_senders_);
+  }
+  return "";
+}
+
+void ChannelObject::Close() {
+  closed_.store(true);
+  std::lock_guard<std::mutex> lock(mutex_);
+  cv_.notify_all();
+}
+
 const std::map<std::string, BuiltInFnType> BuiltInTable = {
     {"len", [](std::vector<std::shared_ptr<Object>> args) -> std::shared_ptr<Object> {
       if (args.size() != 1) {
@@ -21,9 +435,13 @@ const std::map<std::string, BuiltInFnType> BuiltInTable = {
       std::shared_ptr<Object> obj = args[0];
       if (obj->Type() == ObjectType::kString) {
         return std::make_shared<IntegerObject>(
-            std::dynamic_pointer_cast<StringObject>(obj)->value.size());
+            std::dynamic_pointer_cast<StringObject>(obj)->Length());
+      } else if (obj->Type() == ObjectType::kStringBuilder) {
+        std::shared_ptr<StringBuilderObject> builder = std::dynamic_pointer_cast<StringBuilderObject>(obj);
+        std::lock_guard<std::mutex> lock(builder->mutex);
+        return std::make_shared<IntegerObject>(builder->buffer.size());
       } else if (obj->Type() == ObjectType::kArray) {
-        return std::make_shared<IntegerObject>(std::dynamic_pointer_cast<ArrayObject>(obj)->objects.size());
+        return std::make_shared<IntegerObject>(std::dynamic_pointer_cast<ArrayObject>(obj)->Size());
       } else {
         return std::make_shared<ErrorObject>("argument to len not supported, got " + ObjectTypeToString(obj->Type()));
       }
@@ -37,8 +455,8 @@ const std::map<std::string, BuiltInFnType> BuiltInTable = {
         return std::make_shared<ErrorObject>("argument to first must be Array, got " + ObjectTypeToString(obj->Type()));
       }
       std::shared_ptr<ArrayObject> arr = std::dynamic_pointer_cast<ArrayObject>(obj);
-      if (arr->objects.size() > 0) {
-        return arr->objects[0];
+      if (arr->Size() > 0) {
+        return arr->At(0);
       } else {
         return std::make_shared<ErrorObject>("index(0) exceeds array size(0)");
       }
@@ -52,8 +470,8 @@ const std::map<std::string, BuiltInFnType> BuiltInTable = {
         return std::make_shared<ErrorObject>("argument to first must be Array, got " + ObjectTypeToString(obj->Type()));
       }
       std::shared_ptr<ArrayObject> arr = std::dynamic_pointer_cast<ArrayObject>(obj);
-      if (arr->objects.size() > 0) {
-        return arr->objects[arr->objects.size() - 1];
+      if (arr->Size() > 0) {
+        return arr->At(arr->Size() - 1);
       } else {
         return std::make_shared<ErrorObject>("index(0) exceeds array size(0)");
       }
@@ -67,12 +485,8 @@ const std::map<std::string, BuiltInFnType> BuiltInTable = {
         return std::make_shared<ErrorObject>("argument to first must be Array, got " + ObjectTypeToString(obj->Type()));
       }
       std::shared_ptr<ArrayObject> arr = std::dynamic_pointer_cast<ArrayObject>(obj);
-      if (arr->objects.size() > 0) {
-        std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
-        for (int i = 1; i < arr->objects.size(); ++i) {
-          ret->objects.push_back(arr->objects[i]);
-        }
-        return ret;
+      if (arr->Size() > 0) {
+        return arr->Rest();
       } else {
         return std::make_shared<ErrorObject>("index(0) exceeds array size(0)");
       }
@@ -84,11 +498,8 @@ const std::map<std::string, BuiltInFnType> BuiltInTable = {
       if (args[0]->Type() != ObjectType::kArray) {
         return std::make_shared<ErrorObject>("argument to push must be Array, got " + ObjectTypeToString(args[0]->Type()));
       }
-      std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
       std::shared_ptr<ArrayObject> input = std::dynamic_pointer_cast<ArrayObject>(args[0]);
-      ret->objects = input->objects;
-      ret->objects.push_back(args[1]);
-      return ret;
+      return input->Push(args[1]);
     }},
     {"map", [](std::vector<std::shared_ptr<Object>> args) -> std::shared_ptr<Object> {
       if (args.size() != 2) {
@@ -106,51 +517,201 @@ const std::map<std::string, BuiltInFnType> BuiltInTable = {
       if (fn->parameters.size() != 1) {
         return std::make_shared<ErrorObject>("operator of map parameter number should be 1");
       }
-      for (auto elem : input->objects) {
-        std::shared_ptr<Environment> nested_env = std::make_shared<Environment>(fn->env);
-        nested_env->Set(fn->parameters[0].value, elem);
-        std::shared_ptr<Object> output = fn->body->Eval(nested_env);
+      for (size_t i = 0; i < input->Size(); ++i) {
+        std::shared_ptr<Object> output = ApplyFunction(fn, {input->At(i)});
         if (output != nullptr && output->Type() == ObjectType::kError) {
           return output;
         } else {
-          ret->objects.push_back(output);
+          ret->Append(output);
         }
       }
        return ret;
      }},
+    {"builder", [](std::vector<std::shared_ptr<Object>> args) -> std::shared_ptr<Object> {
+      if (args.size() > 1) {
+        return std::make_shared<ErrorObject>("wrong number of arguments");
+      }
+      std::shared_ptr<StringBuilderObject> ret = std::make_shared<StringBuilderObject>();
+      if (args.size() == 1) {
+        if (args[0]->Type() != ObjectType::kString) {
+          return std::make_shared<ErrorObject>("argument to builder must be String, got " + ObjectTypeToString(args[0]->Type()));
+        }
+        ret->buffer = std::dynamic_pointer_cast<StringObject>(args[0])->View();
+      }
+      return ret;
+    }},
+    {"append", [](std::vector<std::shared_ptr<Object>> args) -> std::shared_ptr<Object> {
+      if (args.size() < 1) {
+        return std::make_shared<ErrorObject>("wrong number of arguments");
+      }
+      if (args[0]->Type() != ObjectType::kStringBuilder) {
+        return std::make_shared<ErrorObject>("argument to append must be StringBuilder, got " + ObjectTypeToString(args[0]->Type()));
+      }
+      std::shared_ptr<StringBuilderObject> builder = std::dynamic_pointer_cast<StringBuilderObject>(args[0]);
+      std::lock_guard<std::mutex> lock(builder->mutex);
+      for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i]->Type() == ObjectType::kString) {
+          builder->buffer += std::dynamic_pointer_cast<StringObject>(args[i])->View();
+        } else {
+          builder->buffer += args[i]->Inspect();
+        }
+      }
+      return builder;
+    }},
+    {"build", [](std::vector<std::shared_ptr<Object>> args) -> std::shared_ptr<Object> {
+      if (args.size() != 1) {
+        return std::make_shared<ErrorObject>("wrong number of arguments");
+      }
+      if (args[0]->Type() != ObjectType::kStringBuilder) {
+        return std::make_shared<ErrorObject>("argument to build must be StringBuilder, got " + ObjectTypeToString(args[0]->Type()));
+      }
+      std::shared_ptr<StringBuilderObject> builder = std::dynamic_pointer_cast<StringBuilderObject>(args[0]);
+      std::lock_guard<std::mutex> lock(builder->mutex);
+      return std::make_shared<StringObject>(builder->buffer);
+    }},
+    {"sum", BuiltInSum},
+    {"min", BuiltInMin},
+    {"max", BuiltInMax},
+    {"dot", BuiltInDot},
+    {"add", BuiltInAdd},
+    {"mul", BuiltInMul},
+    {"sort", BuiltInSort},
+    {"reduce", BuiltInReduce},
+    {"filter", BuiltInFilter},
+    {"range", BuiltInRange},
+    {"reverse", BuiltInReverse},
+    {"contains", BuiltInContains},
+    {"index_of", BuiltInIndexOf},
+    {"iter", BuiltInIter},
+    {"lazy_map", BuiltInLazyMap},
+    {"lazy_filter", BuiltInLazyFilter},
+    {"take", BuiltInTake},
+    {"collect", BuiltInCollect},
+    {"split", BuiltInSplit},
+    {"join", BuiltInJoin},
+    {"find", BuiltInFind},
+    {"replace", BuiltInReplace},
+    {"starts_with", BuiltInStartsWith},
+    {"ends_with", BuiltInEndsWith},
+    {"trim", BuiltInTrim},
+    {"upper", BuiltInUpper},
+    {"lower", BuiltInLower},
+    {"read_file", BuiltInReadFile},
+    {"lines", BuiltInLines},
+    {"write_file", BuiltInWriteFile},
+    {"json_parse", BuiltInJsonParse},
+    {"json_stringify", BuiltInJsonStringify},
+    {"channel", BuiltInChannel},
+    {"send", BuiltInSend},
+    {"recv", BuiltInRecv},
+    {"close", BuiltInClose},
+    {"spawn", BuiltInSpawn},
+    {"await", BuiltInAwait},
+    {"pmap", BuiltInParallelMap},
+    {"pfilter", BuiltInParallelFilter},
+    {"preduce", BuiltInParallelReduce},
+    {"gc_stats", [](std::vector<std::shared_ptr<Object>> args) -> std::shared_ptr<Object> {
+      if (args.size() != 0) {
+        return std::make_shared<ErrorObject>("wrong number of arguments");
+      }
+      Heap* heap = Heap::Current();
+      if (heap == nullptr) {
+        return std::make_shared<NullObject>();
+      }
+      GcStats stats = heap->stats();
+      std::shared_ptr<HashObject> ret = std::make_shared<HashObject>();
+      auto put = [&ret](const std::string& key, int64_t value) {
+        ret->table.Set(std::make_shared<StringObject>(key), std::make_shared<IntegerObject>(value));
+      };
+      put("collections", stats.collections);
+      put("freed_environments", stats.freed_environments);
+      put("live_environments", stats.live_environments);
+      put("peak_environments", stats.peak_environments);
+      put("last_pause_ns", stats.last_pause_ns);
+      put("max_pause_ns", stats.max_pause_ns);
+      put("total_pause_ns", stats.total_pause_ns);
+      return ret;
+    }},
+    {"stats", [](std::vector<std::shared_ptr<Object>> args) -> std::shared_ptr<Object> {
+      if (args.size() != 0) {
+        return std::make_shared<ErrorObject>("wrong number of arguments");
+      }
+      if (!ObjectStatsEnabled()) {
+        return std::make_shared<ErrorObject>("object statistics are off, run goku with --stats");
+      }
+      ObjectStats stats = GetObjectStats();
+      auto put = [](const std::shared_ptr<HashObject>& hash, const std::string& key, int64_t value) {
+        hash->table.Set(std::make_shared<StringObject>(key), std::make_shared<IntegerObject>(value));
+      };
+      std::shared_ptr<HashObject> types = std::make_shared<HashObject>();
+      for (size_t i = 0; i < stats.types.size(); ++i) {
+        if (stats.types[i].allocated == 0) {
+          continue;
+        }
+        std::shared_ptr<HashObject> type = std::make_shared<HashObject>();
+        put(type, "allocated", stats.types[i].allocated);
+        put(type, "live", stats.types[i].live);
+        put(type, "bytes", stats.types[i].bytes);
+        types->table.Set(std::make_shared<StringObject>(ObjectTypeToString(static_cast<ObjectType>(i))), type);
+      }
+      std::shared_ptr<HashObject> ret = std::make_shared<HashObject>();
+      ret->table.Set(std::make_shared<StringObject>("types"), types);
+      put(ret, "live_objects", stats.live_objects);
+      put(ret, "peak_objects", stats.peak_objects);
+      put(ret, "temporaries", stats.temporaries);
+      put(ret, "retained", stats.retained);
+      put(ret, "environments", stats.environments);
+      put(ret, "live_environments", stats.live_environments);
+      put(ret, "evaluations", stats.evaluations);
+      return ret;
+    }},
 };
 
 
-bool ObjectEqual::operator()(std::shared_ptr<Object> lhs, std::shared_ptr<Object> rhs) const {
+bool ObjectsEqual(Object* lhs, Object* rhs) {
+  if (lhs == rhs) {
+    return true;
+  }
   if (lhs->Type() != rhs->Type()) {
     return false;
   }
   switch (lhs->Type()) {
   case ObjectType::kInteger:
-    return std::dynamic_pointer_cast<IntegerObject>(lhs)->value == std::dynamic_pointer_cast<IntegerObject>(rhs)->value;
+    return static_cast<IntegerObject*>(lhs)->value == static_cast<IntegerObject*>(rhs)->value;
+  case ObjectType::kFloat:
+    return static_cast<FloatObject*>(lhs)->value == static_cast<FloatObject*>(rhs)->value;
   case ObjectType::kBoolean:
-    return std::dynamic_pointer_cast<BooleanObject>(lhs)->value == std::dynamic_pointer_cast<BooleanObject>(rhs)->value;
+    return static_cast<BooleanObject*>(lhs)->value == static_cast<BooleanObject*>(rhs)->value;
   case ObjectType::kNull:
     return true;
   case ObjectType::kReturnValue:
-    return ObjectEqual()(std::dynamic_pointer_cast<ReturnValueObject>(lhs)->value, std::dynamic_pointer_cast<ReturnValueObject>(rhs)->value);
+    return ObjectsEqual(static_cast<ReturnValueObject*>(lhs)->value.get(),
+                        static_cast<ReturnValueObject*>(rhs)->value.get());
   case ObjectType::kError:
-    return std::dynamic_pointer_cast<ErrorObject>(lhs)->message == std::dynamic_pointer_cast<ErrorObject>(rhs)->message;
+    return static_cast<ErrorObject*>(lhs)->message == static_cast<ErrorObject*>(rhs)->message;
   case ObjectType::kFunction:
     return false;
   case ObjectType::kString:
-    return std::dynamic_pointer_cast<StringObject>(lhs)->value == std::dynamic_pointer_cast<StringObject>(rhs)->value;
+  {
+    auto casted_lhs = static_cast<StringObject*>(lhs);
+    auto casted_rhs = static_cast<StringObject*>(rhs);
+    return casted_lhs->Length() == casted_rhs->Length() && casted_lhs->View() == casted_rhs->View();
+  }
   case ObjectType::kBuiltIn:
     return false;
   case ObjectType::kArray:
   {
-    auto& lhs_array = std::dynamic_pointer_cast<ArrayObject>(lhs)->objects;
-    auto& rhs_array = std::dynamic_pointer_cast<ArrayObject>(rhs)->objects;
-    if (lhs_array.size() != rhs_array.size()) {
+    auto lhs_array = static_cast<ArrayObject*>(lhs);
+    auto rhs_array = static_cast<ArrayObject*>(rhs);
+    if (lhs_array->Size() != rhs_array->Size()) {
       return false;
     }
-    for (size_t i = 0; i < lhs_array.size(); ++i) {
-      if (!ObjectEqual()(lhs_array[i], rhs_array[i])) {
+    if (lhs_array->IsInts() && rhs_array->IsInts()) {
+      return std::equal(lhs_array->ints.data(), lhs_array->ints.data() + lhs_array->Size(),
+                        rhs_array->ints.data());
+    }
+    for (size_t i = 0; i < lhs_array->Size(); ++i) {
+      if (!ObjectsEqual(lhs_array->At(i).get(), rhs_array->At(i).get())) {
         return false;
       }
     }
@@ -158,16 +719,14 @@ bool ObjectEqual::operator()(std::shared_ptr<Object> lhs, std::shared_ptr<Object
   }
   case ObjectType::kHash:
   {
-    auto& lhs_map = std::dynamic_pointer_cast<HashObject>(lhs)->table;
-    auto& rhs_map = std::dynamic_pointer_cast<HashObject>(rhs)->table;
+    auto& lhs_map = static_cast<HashObject*>(lhs)->table;
+    auto& rhs_map = static_cast<HashObject*>(rhs)->table;
     if (lhs_map.size() != rhs_map.size()) {
       return false;
     }
-    for (auto& pair : lhs_map) {
-      auto iter = rhs_map.find(pair.first);
-      if (iter == rhs_map.end()) {
-        return false;
-      } else if (!ObjectEqual()(pair.second, iter->second)) {
+    for (auto& entry : lhs_map) {
+      std::shared_ptr<Object> value = rhs_map.Find(entry.key);
+      if (value == nullptr || !ObjectsEqual(entry.value.get(), value.get())) {
         return false;
       }
     }
@@ -1,24 +1,28 @@
 #ifndef SRC_OBJECT_H_
 #define SRC_OBJECT_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 #include <unordered_map>
 
-enum class ObjectType {
-  kInteger,
-  kBoolean,
-  kNull,
-  kReturnValue,
-  kError,
-  kFunction,
-  kString,
-  kBuiltIn,
-  kArray,
-  kHash,
-};
+#include "budget.h"
+#include "extension.h"
+#include "gc.h"
+#include "mpmc_queue.h"
+#include "object_stats.h"
+#include "object_table.h"
+#include "pvector.h"
+#include "typed_array.h"
+#include "symbol.h"
 
 inline std::string ObjectTypeToString(ObjectType type) {
   switch (type) {
@@ -28,22 +32,72 @@ inline std::string ObjectTypeToString(ObjectType type) {
   case ObjectType::kReturnValue: return "ReturnValue";
   case ObjectType::kError: return "Error";
   case ObjectType::kFunction: return "Function";
+  case ObjectType::kString: return "String";
   case ObjectType::kBuiltIn: return "BuiltIn";
   case ObjectType::kArray: return "Array";
   case ObjectType::kHash: return "Hash";
+  case ObjectType::kStringBuilder: return "StringBuilder";
+  case ObjectType::kSequence: return "Sequence";
+  case ObjectType::kFloat: return "Float";
+  case ObjectType::kTask: return "Task";
+  case ObjectType::kChannel: return "Channel";
   default: return "Unknown";
   }
 }
 
+// A hash computed on first use. Objects are shared between threads, so the
+// cache is atomic; threads racing to fill it compute the same value. 0 marks
+// an empty cache.
+class CachedHash {
+ public:
+  template <typename F>
+  size_t Get(F compute) const {
+    size_t ret = value_.load(std::memory_order_relaxed);
+    if (ret == 0) {
+      ret = compute();
+      Set(ret);
+      ret = value_.load(std::memory_order_relaxed);
+    }
+    return ret;
+  }
+
+  void Set(size_t hash) const {
+    value_.store(hash == 0 ? 1 : hash, std::memory_order_relaxed);
+  }
+
+ private:
+  mutable std::atomic<size_t> value_{0};
+};
+
 class Object {
  public:
+  virtual ~Object() = default;
+
   virtual ObjectType Type() = 0;
   virtual std::string Inspect() = 0;
 
   virtual size_t Hash() const = 0;
 };
 
-class IntegerObject : public Object {
+// A second, empty base of every object class that counts its allocations
+// while object statistics are enabled.
+template <ObjectType type, typename T>
+class Counted {
+ protected:
+  Counted() {
+    if (CountsAllocation()) {
+      CountAllocation(type, sizeof(T));
+    }
+  }
+  Counted(const Counted&) : Counted() {}
+  ~Counted() {
+    if (ObjectStatsEnabled()) {
+      CountFree(type);
+    }
+  }
+};
+
+class IntegerObject : public Object, private Counted<ObjectType::kInteger, IntegerObject> {
  public:
   explicit IntegerObject(int64_t v) : value(v) {}
 
@@ -62,7 +116,31 @@ class IntegerObject : public Object {
   int64_t value;
 };
 
-class BooleanObject : public Object {
+// Shortest text that reads back as the same double, always with a '.' or
+// an exponent so it does not read back as an integer.
+std::string FormatFloat(double value);
+
+class FloatObject : public Object, private Counted<ObjectType::kFloat, FloatObject> {
+ public:
+  explicit FloatObject(double v) : value(v) {}
+
+  ObjectType Type() override {
+    return ObjectType::kFloat;
+  }
+
+  std::string Inspect() override {
+    return FormatFloat(value);
+  }
+
+  size_t Hash() const override {
+    // 0.0 and -0.0 are equal.
+    return value == 0 ? 0 : std::hash<double>()(value);
+  }
+
+  double value;
+};
+
+class BooleanObject : public Object, private Counted<ObjectType::kBoolean, BooleanObject> {
  public:
   explicit BooleanObject(bool v) : value(v) {}
 
@@ -81,7 +159,7 @@ class BooleanObject : public Object {
   bool value;
 };
 
-class NullObject : public Object {
+class NullObject : public Object, private Counted<ObjectType::kNull, NullObject> {
  public:
   ObjectType Type() override {
     return ObjectType::kNull;
@@ -96,7 +174,7 @@ class NullObject : public Object {
   }
 };
 
-class ReturnValueObject : public Object {
+class ReturnValueObject : public Object, private Counted<ObjectType::kReturnValue, ReturnValueObject> {
  public:
   explicit ReturnValueObject(std::shared_ptr<Object> v) : value(v) {}
 
@@ -115,7 +193,7 @@ class ReturnValueObject : public Object {
   std::shared_ptr<Object> value;
 };
 
-class ErrorObject : public Object {
+class ErrorObject : public Object, private Counted<ObjectType::kError, ErrorObject> {
  public:
   explicit ErrorObject(const std::string& m) : message(m) {}
 
@@ -132,31 +210,127 @@ class ErrorObject : public Object {
   std::string message;
 };
 
-class StringObject : public Object {
+// Strings are immutable. Concatenating long strings builds a rope node that
+// only references both operands; the characters are copied once, when the
+// value is first needed (hashing, comparing, printing).
+class StringObject : public Object, private Counted<ObjectType::kString, StringObject> {
  public:
-  explicit StringObject(const std::string& v) : value(v) {}
+  explicit StringObject(const std::string& v) : value_(v), length_(v.size()) {
+    ChargeBudget(length_);
+  }
+  explicit StringObject(std::string&& v) : value_(std::move(v)), length_(value_.size()) {
+    ChargeBudget(length_);
+  }
+  StringObject(std::shared_ptr<StringObject> left, std::shared_ptr<StringObject> right)
+      : length_(left->length_ + right->length_), left_(left), right_(right), flat_(false) {}
+  // A string viewing [data, data + length) of memory kept alive by owner,
+  // say a mapped file. Nothing is copied until Value() is called.
+  StringObject(std::shared_ptr<const void> owner, const char* data, size_t length)
+      : length_(length), owner_(std::move(owner)), view_(data), flat_(false) {}
+  ~StringObject() override;
 
   ObjectType Type() override { return ObjectType::kString; }
 
   std::string Inspect() override {
-    return value;
+    return std::string(View());
+  }
+
+  size_t Hash() const override {
+    return hash_.Get([this]() { return std::hash<std::string_view>()(View()); });
+  }
+
+  const std::string& Value() const {
+    if (!flat_.load(std::memory_order_acquire)) {
+      Flatten();
+    }
+    return value_;
+  }
+
+  // Like Value(), but views stay uncopied.
+  std::string_view View() const {
+    if (view_ != nullptr) {
+      return std::string_view(view_, length_);
+    }
+    return Value();
+  }
+
+  size_t Length() const { return length_; }
+
+  bool IsRope() const { return view_ == nullptr && !flat_.load(std::memory_order_acquire); }
+
+ private:
+  void Flatten() const;
+
+  mutable std::string value_;
+  size_t length_;
+  CachedHash hash_;
+  // Rope children, dropped once flattened. Several threads may flatten
+  // overlapping ropes, so they are accessed with the atomic shared_ptr
+  // functions and flattening runs once per node.
+  mutable std::shared_ptr<StringObject> left_;
+  mutable std::shared_ptr<StringObject> right_;
+  // Views keep their memory even once copied into value_: a concurrent
+  // View() may still be reading it.
+  std::shared_ptr<const void> owner_;
+  const char* view_ = nullptr;
+  mutable std::atomic<bool> flat_{true};
+  mutable std::once_flag flatten_once_;
+
+  friend std::shared_ptr<StringObject> SliceString(const std::shared_ptr<StringObject>& str,
+                                                   size_t pos, size_t length);
+};
+
+// The string literals of one program, so repeated literals are one object
+// with one cached hash. They live as long as the program's syntax tree
+// rather than the process.
+class StringLiterals {
+ public:
+  std::shared_ptr<StringObject> Get(const std::string& value);
+
+ private:
+  std::unordered_map<std::string, std::shared_ptr<StringObject>> table_;
+};
+
+// Concatenates two strings, copying short results and building a rope node
+// for long ones.
+std::shared_ptr<StringObject> ConcatStrings(std::shared_ptr<StringObject> left,
+                                            std::shared_ptr<StringObject> right);
+
+// Bytes [pos, pos + length) of str. Longer slices are views sharing str's
+// memory; short ones are copied.
+std::shared_ptr<StringObject> SliceString(const std::shared_ptr<StringObject>& str,
+                                          size_t pos, size_t length);
+
+// The one mutable object type. Appends lock, so concurrent appends are
+// safe, though their order is not deterministic.
+class StringBuilderObject : public Object, private Counted<ObjectType::kStringBuilder, StringBuilderObject> {
+ public:
+  StringBuilderObject() {}
+
+  ObjectType Type() override { return ObjectType::kStringBuilder; }
+
+  std::string Inspect() override {
+    std::lock_guard<std::mutex> lock(mutex);
+    return "builder(" + std::to_string(buffer.size()) + ")";
   }
 
   size_t Hash() const override {
-    return std::hash<std::string>()(value);
+    return 7;
   }
 
-  std::string value;
+  std::string buffer;
+  std::mutex mutex;
 };
 
 class Identifier;
 class BlockStatement;
 class Environment;
 
-class FunctionObject : public Object {
+class FunctionObject : public Object, private Counted<ObjectType::kFunction, FunctionObject> {
  public:
-  FunctionObject(const std::vector<Identifier>& p, std::shared_ptr<BlockStatement> b, std::shared_ptr<Environment> e)
-      : parameters(p), body(b), env(e) {}
+  FunctionObject(const std::vector<Identifier>& p, std::shared_ptr<BlockStatement> b, std::shared_ptr<Environment> e,
+                 Symbol n = Symbol())
+      : parameters(p), body(b), env(e), name(n) {}
 
   ObjectType Type() override { return ObjectType::kFunction; }
 
@@ -169,13 +343,18 @@ class FunctionObject : public Object {
   std::vector<Identifier> parameters;
   std::shared_ptr<BlockStatement> body;
   std::shared_ptr<Environment> env;
+  // Of the let binding the function was defined by, for profiles.
+  Symbol name;
 };
 
 using BuiltInFnType = std::function<std::shared_ptr<Object>(std::vector<std::shared_ptr<Object>>)>;
 
-class BuiltInObject : public Object {
+// Core builtins take their arguments by value; builtins loaded from native
+// extensions set native instead and see the caller's arguments in place.
+class BuiltInObject : public Object, private Counted<ObjectType::kBuiltIn, BuiltInObject> {
  public:
   BuiltInObject(const BuiltInFnType& f) : fn(f) {}
+  explicit BuiltInObject(NativeFnType f) : native(f) {}
 
   ObjectType Type() override { return ObjectType::kBuiltIn; }
 
@@ -186,42 +365,199 @@ class BuiltInObject : public Object {
   }
 
   BuiltInFnType fn;
+  NativeFnType native = nullptr;
 };
 
-class ArrayObject : public Object {
+// Calls a function or builtin object with the given arguments and unwraps
+// its return value. This is the one place that binds parameters, for the
+// evaluator and for builtins calling back into scripts alike. An
+// allocation failing inside the call, std::bad_alloc, becomes its error.
+std::shared_ptr<Object> ApplyFunction(const std::shared_ptr<Object>& fn,
+                                      std::vector<std::shared_ptr<Object>> args);
+
+// Arrays are immutable values. Arrays holding only integers, or only
+// floats, are stored unboxed in a TypedVector (8 bytes per element); the
+// first element of another type converts the array to the generic
+// representation, a persistent vector of objects of which the array sees
+// [begin, end). Either way deriving a new array (push, rest, slices) shares
+// storage with the original instead of copying it. Nothing mutates an array
+// after it was built, so views need no copy-on-write.
+class ArrayObject : public Object, private Counted<ObjectType::kArray, ArrayObject> {
  public:
+  using Elements = PersistentVector<std::shared_ptr<Object>>;
+  using Ints = TypedVector<int64_t>;
+  using Floats = TypedVector<double>;
+
   ArrayObject() {}
+  ArrayObject(const Elements& e, size_t b, size_t en) : elements(e), begin(b), end(en), kind_(kGeneric) {}
+  explicit ArrayObject(const Ints& i) : ints(i) {}
+  explicit ArrayObject(const Floats& f) : floats(f), kind_(kFloats) {}
 
   ObjectType Type() override { return ObjectType::kArray; }
 
   std::string Inspect() override {
     std::string ret = "[";
-    for (auto obj : objects) {
-      ret += obj->Inspect();
-      ret += ",";
+    if (kind_ == kInts) {
+      for (size_t i = 0; i < ints.size(); ++i) {
+        ret += std::to_string(ints[i]);
+        ret += ",";
+      }
+    } else {
+      ForEach([&ret](const std::shared_ptr<Object>& obj) {
+        ret += obj->Inspect();
+        ret += ",";
+      });
     }
     ret += "]";
     return ret;
   }
 
   size_t Hash() const override {
-    return 5;
+    return hash_.Get([this]() {
+      size_t ret = 5;
+      if (kind_ == kInts) {
+        for (size_t i = 0; i < ints.size(); ++i) {
+          ret = (ret * 1000003) ^ std::hash<int64_t>()(ints[i]);
+        }
+      } else {
+        ForEach([&ret](const std::shared_ptr<Object>& obj) {
+          ret = (ret * 1000003) ^ obj->Hash();
+        });
+      }
+      return ret;
+    });
   }
 
-  std::vector<std::shared_ptr<Object>> objects;
-};
+  // Note that an empty array always counts as integers.
+  bool IsInts() const { return kind_ == kInts; }
+  bool IsFloats() const { return kind_ == kFloats; }
+  bool IsGeneric() const { return kind_ == kGeneric; }
+
+  size_t Size() const {
+    switch (kind_) {
+    case kInts: return ints.size();
+    case kFloats: return floats.size();
+    default: return end - begin;
+    }
+  }
+
+  // Unboxed elements are boxed on access.
+  std::shared_ptr<Object> At(size_t i) const {
+    switch (kind_) {
+    case kInts: return std::make_shared<IntegerObject>(ints[i]);
+    case kFloats: return std::make_shared<FloatObject>(floats[i]);
+    default: return elements[begin + i];
+    }
+  }
+
+  // Only for arrays under construction that nobody else can observe yet.
+  void Append(std::shared_ptr<Object> obj) {
+    ObjectType type = obj != nullptr ? obj->Type() : ObjectType::kNull;
+    if (kind_ == kInts) {
+      if (type == ObjectType::kInteger) {
+        ints = ints.push_back(static_cast<IntegerObject*>(obj.get())->value);
+        return;
+      }
+      if (type == ObjectType::kFloat && ints.empty()) {
+        kind_ = kFloats;
+      } else {
+        toGeneric();
+      }
+    }
+    if (kind_ == kFloats) {
+      if (type == ObjectType::kFloat) {
+        floats = floats.push_back(static_cast<FloatObject*>(obj.get())->value);
+        return;
+      }
+      toGeneric();
+    }
+    elements = elements.push_back(std::move(obj));
+    end = elements.size();
+  }
+
+  std::shared_ptr<ArrayObject> Push(std::shared_ptr<Object> obj) const {
+    ObjectType type = obj != nullptr ? obj->Type() : ObjectType::kNull;
+    if (kind_ == kInts && type == ObjectType::kInteger) {
+      return std::make_shared<ArrayObject>(ints.push_back(static_cast<IntegerObject*>(obj.get())->value));
+    }
+    if (kind_ == kFloats && type == ObjectType::kFloat) {
+      return std::make_shared<ArrayObject>(floats.push_back(static_cast<FloatObject*>(obj.get())->value));
+    }
+    if (kind_ != kGeneric) {
+      std::shared_ptr<ArrayObject> ret = kind_ == kInts ? std::make_shared<ArrayObject>(ints)
+                                                        : std::make_shared<ArrayObject>(floats);
+      ret->Append(std::move(obj));
+      return ret;
+    }
+    if (end == elements.size()) {
+      return std::make_shared<ArrayObject>(elements.push_back(std::move(obj)), begin, end + 1);
+    }
+    // A view ending before its storage: overwrite the hidden slot in a new
+    // version of the storage.
+    return std::make_shared<ArrayObject>(elements.set(end, std::move(obj)), begin, end + 1);
+  }
+
+  // Elements [from, to), sharing storage.
+  std::shared_ptr<ArrayObject> Slice(size_t from, size_t to) const {
+    switch (kind_) {
+    case kInts: return std::make_shared<ArrayObject>(ints.slice(from, to));
+    case kFloats: return std::make_shared<ArrayObject>(floats.slice(from, to));
+    default: return std::make_shared<ArrayObject>(elements, begin + from, begin + to);
+    }
+  }
 
-struct ObjectHash {
-  size_t operator()(std::shared_ptr<Object> obj) const noexcept {
-    return obj->Hash();
+  std::shared_ptr<ArrayObject> Rest() const {
+    return Slice(1, Size());
   }
+
+  template <typename F>
+  void ForEach(F f) const {
+    if (kind_ == kInts) {
+      for (size_t i = 0; i < ints.size(); ++i) {
+        f(std::static_pointer_cast<Object>(std::make_shared<IntegerObject>(ints[i])));
+      }
+    } else if (kind_ == kFloats) {
+      for (size_t i = 0; i < floats.size(); ++i) {
+        f(std::static_pointer_cast<Object>(std::make_shared<FloatObject>(floats[i])));
+      }
+    } else {
+      elements.ForEach(begin, end, f);
+    }
+  }
+
+  Elements elements;
+  size_t begin = 0;
+  size_t end = 0;
+  Ints ints;
+  Floats floats;
+
+ private:
+  enum Kind { kInts, kFloats, kGeneric };
+
+  void toGeneric() {
+    for (size_t i = 0; i < Size(); ++i) {
+      elements = elements.push_back(At(i));
+    }
+    ints = Ints();
+    floats = Floats();
+    begin = 0;
+    end = elements.size();
+    kind_ = kGeneric;
+  }
+
+  Kind kind_ = kInts;
+  CachedHash hash_;
 };
 
+bool ObjectsEqual(Object* lhs, Object* rhs);
+
 struct ObjectEqual {
-  bool operator()(std::shared_ptr<Object> lhs, std::shared_ptr<Object> rhs) const;
+  bool operator()(std::shared_ptr<Object> lhs, std::shared_ptr<Object> rhs) const {
+    return ObjectsEqual(lhs.get(), rhs.get());
+  }
 };
 
-class HashObject : public Object {
+class HashObject : public Object, private Counted<ObjectType::kHash, HashObject> {
  public:
   HashObject() {}
 
@@ -231,22 +567,198 @@ class HashObject : public Object {
 
   std::string Inspect() override {
     std::string ret = "[";
-    for (auto& pair : table) {
-      ret += pair.first->Inspect();
+    for (auto& entry : table) {
+      ret += entry.key->Inspect();
       ret += ": ";
-      ret += pair.second->Inspect();
+      ret += entry.value->Inspect();
       ret += ",";
     }
     ret += "]";
     return ret;
   }
 
+  // Independent of insertion order, like equality.
+  size_t Hash() const override {
+    return hash_.Get([this]() {
+      size_t ret = 6;
+      for (auto& entry : table) {
+        ret += (entry.hash * 1000003) ^ entry.value->Hash();
+      }
+      return ret;
+    });
+  }
+
+  ObjectTable table;
+
+ private:
+  CachedHash hash_;
+};
+
+// A lazy sequence: a source and a chain of map, filter and take stages.
+// Deriving a sequence copies the stage list and shares the source; nothing
+// is evaluated until the sequence is consumed, and then every element runs
+// through all stages before the next one is pulled from the source, so a
+// pipeline needs no intermediate arrays and stops pulling once a take is
+// satisfied.
+class SequenceObject : public Object, private Counted<ObjectType::kSequence, SequenceObject> {
+ public:
+  // One pass over a source. Next returns false at the end; an error object
+  // it yields ends the pass with that error.
+  class Cursor {
+   public:
+    virtual ~Cursor() {}
+    virtual bool Next(std::shared_ptr<Object>* value) = 0;
+  };
+
+  class Source {
+   public:
+    virtual ~Source() {}
+    virtual std::unique_ptr<Cursor> Open() const = 0;
+    // Reports the objects the source keeps alive, for the collector.
+    virtual void ForEachReference(const std::function<void(Object*)>& f) const {}
+  };
+
+  struct Stage {
+    enum Kind { kMap, kFilter, kTake };
+
+    Kind kind;
+    std::shared_ptr<Object> fn;
+    int64_t count;
+  };
+
+  explicit SequenceObject(std::shared_ptr<const Source> s) : source(std::move(s)) {}
+
+  ObjectType Type() override { return ObjectType::kSequence; }
+
+  std::string Inspect() override { return "sequence"; }
+
+  size_t Hash() const override {
+    return 7;
+  }
+
+  std::shared_ptr<SequenceObject> With(Stage stage) const {
+    std::shared_ptr<SequenceObject> ret = std::make_shared<SequenceObject>(source);
+    ret->stages = stages;
+    ret->stages.push_back(std::move(stage));
+    return ret;
+  }
+
+  // Passes each element coming out of the last stage to f until f returns
+  // false or the sequence ends. Returns the first error, or nullptr.
+  std::shared_ptr<Object> Run(const std::function<bool(std::shared_ptr<Object>)>& f) const;
+
+  std::shared_ptr<const Source> source;
+  std::vector<Stage> stages;
+};
+
+// A function call started by spawn. It is queued on the default thread pool
+// and runs on whichever thread gets to it first: a worker, or a thread that
+// awaits it before any worker did. It is queued even when the pool has no
+// workers, so spawn never runs the call itself.
+class TaskObject : public Object, private Counted<ObjectType::kTask, TaskObject> {
+ public:
+  TaskObject(std::shared_ptr<Object> f, std::vector<std::shared_ptr<Object>> a)
+      : fn(std::move(f)), args(std::move(a)) {}
+
+  ObjectType Type() override { return ObjectType::kTask; }
+
+  std::string Inspect() override { return Done() ? "task(done)" : "task"; }
+
+  size_t Hash() const override {
+    return 8;
+  }
+
+  // Makes the scopes fn and function arguments can see safe to share, then
+  // queues the call.
+  static std::shared_ptr<TaskObject> Spawn(std::shared_ptr<Object> fn, std::vector<std::shared_ptr<Object>> args);
+
+  // Returns the result once the call finished. A call nobody started yet
+  // runs on the awaiting thread. Otherwise the thread sleeps and a spare
+  // worker runs pending tasks in its place (see ThreadPool::BeginBlocking):
+  // running them itself could leave it stuck in one that blocks, away from
+  // its own script.
+  std::shared_ptr<Object> Await();
+
+  bool Done() const { return state_.load(std::memory_order_acquire) == kDone; }
+
+  // Only meaningful once Done.
+  const std::shared_ptr<Object>& result() const { return result_; }
+
+  std::shared_ptr<Object> fn;
+  std::vector<std::shared_ptr<Object>> args;
+
+ private:
+  enum State { kPending, kRunning, kDone };
+
+  // Evaluates the call unless another thread claimed it. Returns whether
+  // it did; the caller then reports the task finished to its heap.
+  bool run();
+
+  std::atomic<int> state_{kPending};
+  std::shared_ptr<Object> result_;
+  // Wakes awaiting threads once Done.
+  std::mutex mutex_;
+  std::condition_variable done_;
+  Heap* heap_ = nullptr;
+  // The spawning evaluation's, kept alive as the task may outlive it.
+  std::shared_ptr<Budget> budget_;
+};
+
+// A bounded queue of values between tasks or interpreters. Only deeply
+// immutable values are sent (see channel_builtins.cc), so they hold no
+// environment and travel by reference: the receiver shares the sender's
+// objects. Sending and receiving are lock-free while the queue is neither
+// full nor empty; a blocked thread spins briefly and then sleeps until the
+// other side makes progress. It does not run pool tasks itself, since it
+// could not return to its own operation before the task it picked
+// finished, but a spare pool worker takes its place while it sleeps (see
+// ThreadPool::BeginBlocking). So stages blocked on each other never starve
+// the stages they wait for, however few cores there are.
+class ChannelObject : public Object, private Counted<ObjectType::kChannel, ChannelObject> {
+ public:
+  explicit ChannelObject(size_t capacity) : queue_(capacity) {}
+
+  ObjectType Type() override { return ObjectType::kChannel; }
+
+  std::string Inspect() override { return "channel"; }
+
   size_t Hash() const override {
-    return 6;
+    return 9;
   }
 
-  std::unordered_map<std::shared_ptr<Object>, std::shared_ptr<Object>,
-                     ObjectHash, ObjectEqual> table;
+  // Waits while the channel is full. Returns an empty string once sent,
+  // otherwise why not: the channel is closed, the evaluation's budget ran
+  // out or was cancelled while waiting, or so many threads are blocked
+  // already that waiting could hang. A send racing with Close either
+  // fails or is received.
+  std::string Send(std::shared_ptr<Object> value);
+
+  // Waits for a value. Sets *value to nullptr once the channel is closed
+  // and drained. Returns an empty string unless waiting failed, like Send.
+  std::string Recv(std::shared_ptr<Object>* value);
+
+  void Close();
+
+  size_t Capacity() const { return queue_.capacity(); }
+
+ private:
+  // Sleeps until ready() holds, counted in waiters so the other side knows
+  // to wake it. Returns an empty string then, otherwise why it stopped
+  // waiting: the current budget is exhausted, or the pool can not spare a
+  // worker, in which case it does not wait at all.
+  template <typename Ready>
+  std::string sleep(std::atomic<int>& waiters, Ready ready);
+  void wake(std::atomic<int>& waiters);
+
+  BoundedQueue<std::shared_ptr<Object>> queue_;
+  // Sequentially consistent, with sending_, so either a sender sees
+  // closed_ or Recv sees it in sending_.
+  std::atomic<bool> closed_{false};
+  std::atomic<int> sending_{0};
+  std::atomic<int> blocked_senders_{0};
+  std::atomic<int> blocked_receivers_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
 };
 
 // inline bool ObjectEqual(std::shared_ptr<Object> left, std::shared_ptr<Object> right) {
@@ -269,6 +781,8 @@ class HashObject : public Object {
 inline bool IsTruthy(std::shared_ptr<Object> obj) {
   if (obj->Type() == ObjectType::kInteger) {
     return std::dynamic_pointer_cast<IntegerObject>(obj)->value != 0;
+  } else if (obj->Type() == ObjectType::kFloat) {
+    return static_cast<FloatObject*>(obj.get())->value != 0;
   } else if (obj->Type() == ObjectType::kBoolean) {
     return std::dynamic_pointer_cast<BooleanObject>(obj)->value;
   } else {
@@ -276,7 +790,7 @@ inline bool IsTruthy(std::shared_ptr<Object> obj) {
   }
 }
 
-class Environment {
+class Environment : public std::enable_shared_from_this<Environment> {
  public:
   Environment(std::shared_ptr<Environment> outer = nullptr) : outer(outer) {
 #if 0
@@ -286,29 +800,116 @@ class Environment {
       std::cout << "created environment: " << this << " from environment: " << outer.get() << std::endl;
     }
 #endif
+    Heap* heap = Heap::Current();
+    if (heap != nullptr) {
+      heap->Register(this);
+    }
+    ChargeBudget(sizeof(Environment));
+    if (CountsAllocation()) {
+      CountEnvironment(1);
+    }
+  }
+
+  ~Environment() {
+    if (ObjectStatsEnabled()) {
+      CountEnvironment(-1);
+    }
+    if (heap_ != nullptr) {
+      heap_->Unregister(this);
+    }
+  }
+
+  std::shared_ptr<Object> Get(Symbol name) {
+    for (Environment* env = this; env != nullptr; env = env->outer.get()) {
+      if (env->lock_ != nullptr) {
+        std::shared_lock<std::shared_mutex> lock(*env->lock_);
+        int slot = env->find(name);
+        if (slot >= 0) {
+          return env->objects[slot].second;
+        }
+        continue;
+      }
+      int slot = env->find(name);
+      if (slot >= 0) {
+        return env->objects[slot].second;
+      }
+    }
+    return nullptr;
   }
 
   std::shared_ptr<Object> Get(const std::string& name) {
-    auto iter = objects.find(name);
-    if (iter != objects.end()) {
-      return iter->second;
-    } else {
-      if (outer == nullptr) {
-        return nullptr;
-      } else {
-        return outer->Get(name);
+    return Get(Symbol::Intern(name));
+  }
+
+  void Set(Symbol name, std::shared_ptr<Object> obj) {
+    std::unique_lock<std::shared_mutex> lock;
+    if (lock_ != nullptr) {
+      lock = std::unique_lock<std::shared_mutex>(*lock_);
+    }
+    if (find(name) >= 0) {
+      return;
+    }
+    objects.emplace_back(name, obj);
+    if (!index_.empty()) {
+      index_.emplace(name, objects.size() - 1);
+    } else if (objects.size() > kMaxLinearBindings) {
+      for (size_t i = 0; i < objects.size(); ++i) {
+        index_.emplace(objects[i].first, i);
       }
     }
   }
 
   void Set(const std::string& name, std::shared_ptr<Object> obj) {
-    objects.emplace(name, obj);
+    Set(Symbol::Intern(name), obj);
   }
 
-  std::map<std::string, std::shared_ptr<Object>> objects;
+  // Gives this scope and its ancestors a lock, before a task that can see
+  // them starts: the thread that created a scope may still be adding
+  // bindings while tasks look names up. Ancestors of a shared scope are
+  // shared already, and only its creator can see an unshared scope, so the
+  // walk needs no synchronization.
+  void Share() {
+    for (Environment* env = this; env != nullptr && env->lock_ == nullptr; env = env->outer.get()) {
+      env->lock_.reset(new std::shared_mutex());
+    }
+  }
+
+  // Bindings in definition order. Small scopes (function calls) are scanned
+  // linearly by symbol; larger ones, usually the global scope, get an index.
+  std::vector<std::pair<Symbol, std::shared_ptr<Object>>> objects;
   std::shared_ptr<Environment> outer;
+
+ private:
+  friend class Heap;
+  friend class HostRoot;
+
+  static const size_t kMaxLinearBindings = 8;
+
+  int find(Symbol name) const {
+    if (index_.empty()) {
+      for (size_t i = 0; i < objects.size(); ++i) {
+        if (objects[i].first == name) {
+          return static_cast<int>(i);
+        }
+      }
+      return -1;
+    }
+    auto iter = index_.find(name);
+    return iter == index_.end() ? -1 : static_cast<int>(iter->second);
+  }
+
+  std::unordered_map<Symbol, size_t> index_;
+  // Set once tasks may use the scope concurrently, see Share.
+  std::unique_ptr<std::shared_mutex> lock_;
+  Heap* heap_ = nullptr;
+  Environment* gc_prev_ = nullptr;
+  Environment* gc_next_ = nullptr;
+  uint32_t gc_mark_ = 0;
 };
 
 extern const std::map<std::string, BuiltInFnType> BuiltInTable;
 
+// Names the parser resolves to builtins.
+using BuiltInBindings = std::unordered_map<std::string, std::shared_ptr<BuiltInObject>>;
+
 #endif  // SRC_OBJECT_H_
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "object_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
+#include "ast.h"
+#include "object.h"
+
+namespace {
+
+const size_t kObjectTypes = static_cast<size_t>(ObjectType::kChannel) + 1;
+
+struct Counters {
+  std::atomic<int64_t> allocated{0};
+  std::atomic<int64_t> live{0};
+  std::atomic<int64_t> bytes{0};
+};
+
+Counters type_counters[kObjectTypes];
+std::atomic<int64_t> allocated_objects{0};
+std::atomic<int64_t> freed_objects{0};
+std::atomic<int64_t> peak_objects{0};
+std::atomic<int64_t> environments{0};
+std::atomic<int64_t> live_environments{0};
+std::atomic<int64_t> evaluations{0};
+
+// Guards the safe point estimates.
+std::mutex safe_point_mutex;
+int64_t last_allocated = 0;
+int64_t last_freed = 0;
+int64_t temporaries = 0;
+int64_t retained = 0;
+
+}  // namespace
+
+bool EnableObjectStats() {
+  int state = kObjectStatsUnused;
+  return object_stats_state.compare_exchange_strong(state, kObjectStatsOn, std::memory_order_relaxed) ||
+         state == kObjectStatsOn;
+}
+
+void CountAllocation(ObjectType type, size_t bytes) {
+  Counters& counters = type_counters[static_cast<size_t>(type)];
+  counters.allocated.fetch_add(1, std::memory_order_relaxed);
+  counters.live.fetch_add(1, std::memory_order_relaxed);
+  counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  int64_t live = allocated_objects.fetch_add(1, std::memory_order_relaxed) + 1 -
+                 freed_objects.load(std::memory_order_relaxed);
+  int64_t peak = peak_objects.load(std::memory_order_relaxed);
+  while (live > peak && !peak_objects.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+void CountFree(ObjectType type) {
+  type_counters[static_cast<size_t>(type)].live.fetch_sub(1, std::memory_order_relaxed);
+  freed_objects.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountEnvironment(int delta) {
+  if (delta > 0) {
+    environments.fetch_add(delta, std::memory_order_relaxed);
+  }
+  live_environments.fetch_add(delta, std::memory_order_relaxed);
+}
+
+void CountEvaluation() {
+  evaluations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ObjectStatsSafePoint() {
+  std::lock_guard<std::mutex> lock(safe_point_mutex);
+  int64_t allocated = allocated_objects.load(std::memory_order_relaxed);
+  int64_t freed = freed_objects.load(std::memory_order_relaxed);
+  int64_t new_objects = allocated - last_allocated;
+  int64_t short_lived = std::min(new_objects, freed - last_freed);
+  temporaries += short_lived;
+  retained += new_objects - short_lived;
+  last_allocated = allocated;
+  last_freed = freed;
+}
+
+ObjectStats GetObjectStats() {
+  ObjectStats stats;
+  stats.types.resize(kObjectTypes);
+  for (size_t i = 0; i < kObjectTypes; ++i) {
+    stats.types[i].allocated = type_counters[i].allocated.load(std::memory_order_relaxed);
+    stats.types[i].live = type_counters[i].live.load(std::memory_order_relaxed);
+    stats.types[i].bytes = type_counters[i].bytes.load(std::memory_order_relaxed);
+  }
+  stats.live_objects = allocated_objects.load(std::memory_order_relaxed) - freed_objects.load(std::memory_order_relaxed);
+  stats.peak_objects = peak_objects.load(std::memory_order_relaxed);
+  stats.environments = environments.load(std::memory_order_relaxed);
+  stats.live_environments = live_environments.load(std::memory_order_relaxed);
+  stats.evaluations = evaluations.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(safe_point_mutex);
+  stats.temporaries = temporaries;
+  stats.retained = retained;
+  return stats;
+}
+
+void WriteObjectStats(std::ostream& out) {
+  ObjectStats stats = GetObjectStats();
+  char line[96];
+  std::snprintf(line, sizeof(line), "%-14s %14s %12s %14s\n", "type", "allocated", "live", "bytes");
+  out << line;
+  for (size_t i = 0; i < kObjectTypes; ++i) {
+    const TypeStats& type = stats.types[i];
+    if (type.allocated == 0) {
+      continue;
+    }
+    std::snprintf(line, sizeof(line), "%-14s %14lld %12lld %14lld\n",
+                  ObjectTypeToString(static_cast<ObjectType>(i)).c_str(), static_cast<long long>(type.allocated),
+                  static_cast<long long>(type.live), static_cast<long long>(type.bytes));
+    out << line;
+  }
+  out << "objects: " << stats.live_objects << " live, " << stats.peak_objects << " peak, "
+      << stats.temporaries << " temporaries, " << stats.retained << " retained\n";
+  out << "environments: " << stats.environments << " created, " << stats.live_environments << " live";
+  if (stats.evaluations > 0) {
+    out << ", " << stats.environments / stats.evaluations << " per evaluation over " << stats.evaluations;
+  }
+  out << '\n';
+}
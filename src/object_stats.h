@@ -0,0 +1,80 @@
+#ifndef SRC_OBJECT_STATS_H_
+#define SRC_OBJECT_STATS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+enum class ObjectType;
+
+// Process-wide allocation counters, off by default. Enabling them makes
+// every object and environment allocation touch shared atomics, so it is
+// meant for diagnosing a script (goku --stats), not for production.
+// Counters are only exact if they saw every object, so enabling them fails
+// once the first object or environment has been created.
+//
+// Bytes are the sizes of the object classes themselves. String characters
+// and array and hash storage are not included; budgets count those (see
+// budget.h).
+//
+// Whether an object is short-lived is estimated at safe points, the ends
+// of top-level statements: of the objects allocated since the previous
+// safe point, as many as were freed meanwhile count as temporaries and the
+// rest as retained. This is exact unless a statement frees objects that
+// earlier statements created.
+struct TypeStats {
+  int64_t allocated = 0;
+  int64_t live = 0;
+  int64_t bytes = 0;
+};
+
+struct ObjectStats {
+  // Indexed by ObjectType.
+  std::vector<TypeStats> types;
+  int64_t live_objects = 0;
+  int64_t peak_objects = 0;
+  int64_t temporaries = 0;
+  int64_t retained = 0;
+  int64_t environments = 0;
+  int64_t live_environments = 0;
+  // Programs evaluated: REPL lines, scripts and Interpreter::Call.
+  int64_t evaluations = 0;
+};
+
+// Unused until the first allocation, which turns the counters off for
+// good unless they were enabled before.
+enum ObjectStatsState { kObjectStatsUnused, kObjectStatsOff, kObjectStatsOn };
+
+inline std::atomic<int> object_stats_state{kObjectStatsUnused};
+
+inline bool ObjectStatsEnabled() {
+  return object_stats_state.load(std::memory_order_relaxed) == kObjectStatsOn;
+}
+
+// Whether to count an allocation about to happen.
+inline bool CountsAllocation() {
+  int state = object_stats_state.load(std::memory_order_relaxed);
+  if (state == kObjectStatsUnused) {
+    // On failure, state is what EnableObjectStats set meanwhile.
+    object_stats_state.compare_exchange_strong(state, kObjectStatsOff, std::memory_order_relaxed);
+  }
+  return state == kObjectStatsOn;
+}
+
+// Returns false if objects were created already.
+bool EnableObjectStats();
+
+void CountAllocation(ObjectType type, size_t bytes);
+void CountFree(ObjectType type);
+void CountEnvironment(int delta);
+void CountEvaluation();
+void ObjectStatsSafePoint();
+
+ObjectStats GetObjectStats();
+
+// A table of the types allocated so far and the totals.
+void WriteObjectStats(std::ostream& out);
+
+#endif  // SRC_OBJECT_STATS_H_
@@ -0,0 +1,89 @@
+#include "object_table.h"
+
+#include "ast.h"
+#include "object.h"
+
+const int32_t ObjectTable::kEmpty;
+
+size_t ObjectTable::slotOf(size_t hash) const {
+  // Fibonacci hashing spreads identity-hashed integers over the index.
+  return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> shift_);
+}
+
+size_t ObjectTable::probe(Object* key, size_t hash) const {
+  size_t mask = index_.size() - 1;
+  for (size_t slot = slotOf(hash);; slot = (slot + 1) & mask) {
+    int32_t pos = index_[slot];
+    if (pos == kEmpty) {
+      return slot;
+    }
+    const Entry& entry = entries_[pos];
+    if (entry.hash == hash && ObjectsEqual(entry.key.get(), key)) {
+      return slot;
+    }
+  }
+}
+
+std::shared_ptr<Object> ObjectTable::Find(const std::shared_ptr<Object>& key) const {
+  if (entries_.empty()) {
+    return nullptr;
+  }
+  if (dense_ints_ && key->Type() == ObjectType::kInteger) {
+    int64_t value = static_cast<IntegerObject*>(key.get())->value;
+    if (value >= 0 && value < static_cast<int64_t>(entries_.size())) {
+      return entries_[value].value;
+    }
+    return nullptr;
+  }
+  int32_t pos = index_[probe(key.get(), key->Hash())];
+  return pos == kEmpty ? nullptr : entries_[pos].value;
+}
+
+void ObjectTable::Set(std::shared_ptr<Object> key, std::shared_ptr<Object> value) {
+  size_t hash = key->Hash();
+  if (!index_.empty()) {
+    size_t slot = probe(key.get(), hash);
+    if (index_[slot] != kEmpty) {
+      entries_[index_[slot]].value = std::move(value);
+      return;
+    }
+  }
+  // Keep the load factor of the index below 2/3.
+  if ((entries_.size() + 1) * 3 > index_.size() * 2) {
+    rebuild(index_.empty() ? 8 : index_.size() * 2);
+  }
+  if (dense_ints_) {
+    dense_ints_ = key->Type() == ObjectType::kInteger &&
+                  static_cast<IntegerObject*>(key.get())->value == static_cast<int64_t>(entries_.size());
+  }
+  ChargeBudget(sizeof(Entry));
+  index_[probe(key.get(), hash)] = static_cast<int32_t>(entries_.size());
+  entries_.push_back(Entry{hash, std::move(key), std::move(value)});
+}
+
+void ObjectTable::Reserve(size_t size) {
+  entries_.reserve(size);
+  size_t capacity = 8;
+  while (size * 3 > capacity * 2) {
+    capacity *= 2;
+  }
+  if (capacity > index_.size()) {
+    rebuild(capacity);
+  }
+}
+
+void ObjectTable::rebuild(size_t capacity) {
+  index_.assign(capacity, kEmpty);
+  shift_ = 64;
+  for (size_t c = capacity; c > 1; c >>= 1) {
+    --shift_;
+  }
+  size_t mask = capacity - 1;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    size_t slot = slotOf(entries_[i].hash);
+    while (index_[slot] != kEmpty) {
+      slot = (slot + 1) & mask;
+    }
+    index_[slot] = static_cast<int32_t>(i);
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef SRC_OBJECT_TABLE_H_
+#define SRC_OBJECT_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Object;
+
+// Insertion-ordered hash table keyed by objects. Entries are stored densely
+// in insertion order together with their hash; a separate open-addressing
+// array of 32-bit entry indexes is probed linearly. Probes compare stored
+// hashes before comparing keys, and tables whose keys are exactly
+// 0, 1, 2, ... in insertion order are indexed directly.
+class ObjectTable {
+ public:
+  struct Entry {
+    size_t hash;
+    std::shared_ptr<Object> key;
+    std::shared_ptr<Object> value;
+  };
+
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  std::vector<Entry>::const_iterator begin() const { return entries_.begin(); }
+  std::vector<Entry>::const_iterator end() const { return entries_.end(); }
+
+  // Returns nullptr if the key is absent.
+  std::shared_ptr<Object> Find(const std::shared_ptr<Object>& key) const;
+
+  // Inserts the key or replaces the value of an existing one.
+  void Set(std::shared_ptr<Object> key, std::shared_ptr<Object> value);
+
+  void Reserve(size_t size);
+
+ private:
+  static const int32_t kEmpty = -1;
+
+  // Returns the index_ slot holding the key, or the empty slot ending its
+  // probe sequence.
+  size_t probe(Object* key, size_t hash) const;
+  size_t slotOf(size_t hash) const;
+  void rebuild(size_t capacity);
+
+  std::vector<Entry> entries_;
+  std::vector<int32_t> index_;
+  int shift_ = 64;
+  bool dense_ints_ = true;
+};
+
+#endif  // SRC_OBJECT_TABLE_H_
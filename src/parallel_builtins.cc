@@ -0,0 +1,233 @@
+#include "builtins.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "ast.h"
+#include "thread_pool.h"
+
+// pmap, pfilter and preduce split their input array into chunks evaluated
+// on the default thread pool. Results are assembled in input order, and an
+// error reports the failing element with the lowest index, so the outcome
+// matches the sequential builtins whenever the function is pure. A function
+// with side effects (say, appending to a shared builder) still runs safely
+// but in no particular order.
+//
+// spawn and await run single calls concurrently with the rest of the
+// script, on the same pool.
+
+namespace {
+
+std::shared_ptr<Object> CheckArguments(const std::vector<std::shared_ptr<Object>>& args,
+                                       const std::string& name, size_t want) {
+  if (args.size() != want) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (args[0]->Type() != ObjectType::kArray) {
+    return std::make_shared<ErrorObject>("argument to " + name + " must be Array, got " + ObjectTypeToString(args[0]->Type()));
+  }
+  const std::shared_ptr<Object>& fn = args[want - 1];
+  if (fn->Type() != ObjectType::kFunction && fn->Type() != ObjectType::kBuiltIn) {
+    return std::make_shared<ErrorObject>("operation of " + name + " must be function, got " + ObjectTypeToString(fn->Type()));
+  }
+  return nullptr;
+}
+
+bool IsError(const std::shared_ptr<Object>& obj) {
+  return obj != nullptr && obj->Type() == ObjectType::kError;
+}
+
+// Keeps the error of the lowest failing index.
+class FirstError {
+ public:
+  explicit FirstError(size_t n) : index_(n) {}
+
+  // Elements after a known failure need not be evaluated.
+  bool Skip(size_t i) const { return i > index_.load(std::memory_order_relaxed); }
+
+  void Record(size_t i, std::shared_ptr<Object> error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (i < index_.load(std::memory_order_relaxed)) {
+      index_.store(i, std::memory_order_relaxed);
+      error_ = std::move(error);
+    }
+  }
+
+  const std::shared_ptr<Object>& error() const { return error_; }
+
+ private:
+  std::atomic<size_t> index_;
+  std::mutex mutex_;
+  std::shared_ptr<Object> error_;
+};
+
+// Calls fn(i) for every i in [0, n) in parallel, with the caller's heap
+// and budget installed on the workers.
+template <typename F>
+std::shared_ptr<Object> ParallelEach(size_t n, F fn) {
+  Heap* heap = Heap::Current();
+  Budget* budget = Budget::Current();
+  FirstError first_error(n);
+  ThreadPool::Default().ParallelFor(n, [&](size_t begin, size_t end) {
+    HeapScope heap_scope(heap);
+    BudgetScope budget_scope(budget);
+    for (size_t i = begin; i < end && !first_error.Skip(i); ++i) {
+      std::shared_ptr<Object> err = fn(i);
+      if (err != nullptr) {
+        first_error.Record(i, std::move(err));
+        return;
+      }
+    }
+  });
+  return first_error.error();
+}
+
+}  // namespace
+
+std::shared_ptr<Object> BuiltInParallelMap(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckArguments(args, "pmap", 2);
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> input = std::static_pointer_cast<ArrayObject>(args[0]);
+  const std::shared_ptr<Object>& fn = args[1];
+  std::vector<std::shared_ptr<Object>> results(input->Size());
+  err = ParallelEach(input->Size(), [&](size_t i) -> std::shared_ptr<Object> {
+    results[i] = ApplyFunction(fn, {input->At(i)});
+    return IsError(results[i]) ? results[i] : nullptr;
+  });
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+  for (auto& result : results) {
+    ret->Append(std::move(result));
+  }
+  return ret;
+}
+
+std::shared_ptr<Object> BuiltInParallelFilter(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckArguments(args, "pfilter", 2);
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> input = std::static_pointer_cast<ArrayObject>(args[0]);
+  const std::shared_ptr<Object>& fn = args[1];
+  std::vector<char> keep(input->Size());
+  err = ParallelEach(input->Size(), [&](size_t i) -> std::shared_ptr<Object> {
+    std::shared_ptr<Object> output = ApplyFunction(fn, {input->At(i)});
+    if (IsError(output)) {
+      return output;
+    }
+    keep[i] = output != nullptr && IsTruthy(output);
+    return nullptr;
+  });
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+  for (size_t i = 0; i < keep.size(); ++i) {
+    if (keep[i]) {
+      ret->Append(input->At(i));
+    }
+  }
+  return ret;
+}
+
+// preduce(arr, init, fn) reduces every chunk on its own, then folds init and
+// the chunk results in order. fn must be associative.
+std::shared_ptr<Object> BuiltInParallelReduce(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckArguments(args, "preduce", 3);
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> input = std::static_pointer_cast<ArrayObject>(args[0]);
+  const std::shared_ptr<Object>& fn = args[2];
+  size_t n = input->Size();
+  Heap* heap = Heap::Current();
+  Budget* budget = Budget::Current();
+  FirstError first_error(n);
+  std::mutex mutex;
+  std::vector<std::pair<size_t, std::shared_ptr<Object>>> partials;
+  ThreadPool::Default().ParallelFor(n, [&](size_t begin, size_t end) {
+    HeapScope heap_scope(heap);
+    BudgetScope budget_scope(budget);
+    std::shared_ptr<Object> acc = input->At(begin);
+    for (size_t i = begin + 1; i < end; ++i) {
+      if (first_error.Skip(i)) {
+        return;
+      }
+      acc = ApplyFunction(fn, {acc, input->At(i)});
+      if (IsError(acc)) {
+        first_error.Record(i, acc);
+        return;
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    partials.emplace_back(begin, acc);
+  });
+  if (first_error.error() != nullptr) {
+    return first_error.error();
+  }
+  std::sort(partials.begin(), partials.end(),
+            [](const std::pair<size_t, std::shared_ptr<Object>>& lhs,
+               const std::pair<size_t, std::shared_ptr<Object>>& rhs) { return lhs.first < rhs.first; });
+  std::shared_ptr<Object> acc = args[1];
+  for (auto& partial : partials) {
+    acc = ApplyFunction(fn, {acc, partial.second});
+    if (IsError(acc)) {
+      return acc;
+    }
+  }
+  return acc;
+}
+
+// spawn(fn, args...) starts fn(args...) on the thread pool and returns a
+// task to await.
+std::shared_ptr<Object> BuiltInSpawn(std::vector<std::shared_ptr<Object>> args) {
+  if (args.empty()) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<Object> fn = args[0];
+  if (fn->Type() != ObjectType::kFunction && fn->Type() != ObjectType::kBuiltIn) {
+    return std::make_shared<ErrorObject>("argument to spawn must be function, got " + ObjectTypeToString(fn->Type()));
+  }
+  args.erase(args.begin());
+  return TaskObject::Spawn(std::move(fn), std::move(args));
+}
+
+// await(task) is the task's result; await(arr) awaits an array of tasks
+// and returns their results in order.
+std::shared_ptr<Object> BuiltInAwait(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 1) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (args[0]->Type() == ObjectType::kTask) {
+    return static_cast<TaskObject*>(args[0].get())->Await();
+  }
+  if (args[0]->Type() != ObjectType::kArray) {
+    return std::make_shared<ErrorObject>("argument to await must be Task or Array, got " + ObjectTypeToString(args[0]->Type()));
+  }
+  ArrayObject* tasks = static_cast<ArrayObject*>(args[0].get());
+  std::shared_ptr<Object> err;
+  tasks->ForEach([&err](const std::shared_ptr<Object>& task) {
+    if (err == nullptr && task->Type() != ObjectType::kTask) {
+      err = std::make_shared<ErrorObject>("elements of await must be Task, got " + ObjectTypeToString(task->Type()));
+    }
+  });
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+  for (size_t i = 0; i < tasks->Size(); ++i) {
+    std::shared_ptr<Object> result = static_cast<TaskObject*>(tasks->At(i).get())->Await();
+    if (IsError(result)) {
+      return result;
+    }
+    ret->Append(std::move(result));
+  }
+  return ret;
+}
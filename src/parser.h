@@ -1,6 +1,10 @@
 #ifndef SRC_PARSER_H_
 #define SRC_PARSER_H_
 
+#include <functional>
+#include <map>
+#include <unordered_map>
+
 #include "lexer/lexer.h"
 #include "lexer/token.h"
 #include "ast.h"
@@ -32,14 +36,28 @@ static const std::map<TokenType, int> precedences = {
 
 class Parser {
  public:
-  Parser(Lexer* l) : l_(l) {
+  // Builtins are looked up in builtins if given, otherwise in BuiltInTable
+  // and the loaded extensions.
+  explicit Parser(Lexer* l, const BuiltInBindings* builtins = nullptr) : l_(l), builtins_(builtins) {
     nextToken();
     nextToken();
 
     registerPrefix(TokenType::kIdent, [this]() {
       std::shared_ptr<Identifier> ret = std::make_shared<Identifier>();
-      ret->token = curToken_;
-      ret->value = curToken_.literal;
+      initIdentifier(*ret);
+      if (builtins_ != nullptr) {
+        auto iter = builtins_->find(ret->value);
+        if (iter != builtins_->end()) {
+          ret->builtin = iter->second;
+        }
+        return ret;
+      }
+      auto iter = BuiltInTable.find(ret->value);
+      if (iter != BuiltInTable.end()) {
+        ret->builtin = std::make_shared<BuiltInObject>(iter->second);
+      } else if (NativeFnType native = FindExtensionBuiltIn(ret->value)) {
+        ret->builtin = std::make_shared<BuiltInObject>(native);
+      }
       return ret;
     });
     registerPrefix(TokenType::kInt, [this]() {
@@ -48,6 +66,12 @@ class Parser {
       ret->value = std::stoll(curToken_.literal);
       return ret;
     });
+    registerPrefix(TokenType::kFloat, [this]() {
+      std::shared_ptr<FloatLiteral> ret = std::make_shared<FloatLiteral>();
+      ret->token = curToken_;
+      ret->value = std::strtod(curToken_.literal.c_str(), nullptr);
+      return ret;
+    });
     auto parseBoolean = [this]() {
       std::shared_ptr<Boolean> ret = std::make_shared<Boolean>();
       ret->token = curToken_;
@@ -115,6 +139,7 @@ class Parser {
       std::shared_ptr<StringLiteral> ret = std::make_shared<StringLiteral>();
       ret->token = curToken_;
       ret->value = curToken_.literal;
+      ret->object = strings_.Get(ret->value);
       return ret;
     });
     registerPrefix(TokenType::kLBracket, [this]() -> std::shared_ptr<Expression> {
@@ -147,7 +172,7 @@ class Parser {
         }
         nextToken();
         std::shared_ptr<Expression> value = parseExpression(LOWEST);
-        table->pairs[key] = value;
+        table->pairs.emplace_back(key, value);
         if (peekToken_.type != TokenType::kRBrace && !expectPeek(TokenType::kComma)) {
           return nullptr;
         }
@@ -183,11 +208,31 @@ class Parser {
       return ret;
     });
     registerInfix(TokenType::kLBracket, [this](std::shared_ptr<Expression> arr) -> std::shared_ptr<Expression> {
-      std::shared_ptr<IndexExpression> ret = std::make_shared<IndexExpression>();
-      ret->token = curToken_;
-      ret->left = arr;
+      Token token = curToken_;
       nextToken();
-      ret->right = parseExpression(LOWEST);
+      std::shared_ptr<Expression> index;
+      if (curToken_.type != TokenType::kColon) {
+        index = parseExpression(LOWEST);
+        if (peekToken_.type != TokenType::kColon) {
+          std::shared_ptr<IndexExpression> ret = std::make_shared<IndexExpression>();
+          ret->token = token;
+          ret->left = arr;
+          ret->right = index;
+          if (!expectPeek(TokenType::kRBracket)) {
+            return nullptr;
+          }
+          return ret;
+        }
+        nextToken();
+      }
+      std::shared_ptr<SliceExpression> ret = std::make_shared<SliceExpression>();
+      ret->token = token;
+      ret->left = arr;
+      ret->begin = index;
+      if (peekToken_.type != TokenType::kRBracket) {
+        nextToken();
+        ret->end = parseExpression(LOWEST);
+      }
       if (!expectPeek(TokenType::kRBracket)) {
         return nullptr;
       }
@@ -204,6 +249,7 @@ class Parser {
       }
       nextToken();
     }
+    program->names = std::move(names_);
     return program;
   }
 
@@ -238,13 +284,15 @@ class Parser {
       return nullptr;
     }
     stmt->name = std::make_shared<Identifier>();
-    stmt->name->token = curToken_;
-    stmt->name->value = curToken_.literal;
+    initIdentifier(*stmt->name);
     if (!expectPeek(TokenType::kAssign)) {
       return nullptr;
     }
     nextToken();
     stmt->value = parseExpression(LOWEST);
+    if (auto literal = std::dynamic_pointer_cast<FunctionLiteral>(stmt->value)) {
+      literal->name = stmt->name->symbol;
+    }
     if (peekToken_.type == TokenType::kSemicolon) {
       nextToken();
     }
@@ -358,6 +406,16 @@ class Parser {
     }
   }
 
+  void initIdentifier(Identifier& ident) {
+    ident.token = curToken_;
+    ident.value = curToken_.literal;
+    auto iter = names_.find(ident.value);
+    if (iter == names_.end()) {
+      iter = names_.emplace(ident.value, Symbol::Intern(ident.value)).first;
+    }
+    ident.symbol = iter->second;
+  }
+
   std::vector<Identifier> parseFunctionParameters() {
     std::vector<Identifier> ret;
     if (peekToken_.type == TokenType::kRParen) {
@@ -366,16 +424,14 @@ class Parser {
     }
     nextToken();
     Identifier ident;
-    ident.token = curToken_;
-    ident.value = curToken_.literal;
+    initIdentifier(ident);
     ret.push_back(ident);
 
     while (peekToken_.type == TokenType::kComma) {
       nextToken();
       nextToken();
       Identifier cur_ident;
-      cur_ident.token = curToken_;
-      cur_ident.value = curToken_.literal;
+      initIdentifier(cur_ident);
       ret.push_back(cur_ident);
     }
 
@@ -408,9 +464,13 @@ class Parser {
   }
 
   Lexer* l_;
+  const BuiltInBindings* builtins_;
   Token curToken_;
   Token peekToken_;
   std::vector<std::string> errors_;
+  // Interned once per name, not per occurrence.
+  std::unordered_map<std::string, Symbol> names_;
+  StringLiterals strings_;
 
   std::map<TokenType, PrefixParseFn> prefixParseFns;
   std::map<TokenType, InfixParserFn> infixParseFns;
@@ -0,0 +1,134 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "ast.h"
+
+std::atomic<Profiler*> Profiler::active_{nullptr};
+
+namespace {
+
+// The innermost recorded call on this thread.
+thread_local ProfileScope* innermost = nullptr;
+// How many calls of each function are in progress on this thread, to tell
+// the outermost of recursive calls.
+thread_local std::vector<int> active_calls;
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+Profiler::Profiler(const BuiltInBindings& builtins) {
+  for (auto& pair : builtins) {
+    builtin_names_.emplace(pair.second.get(), pair.first);
+  }
+  stacks_.emplace_back(0, 0);
+}
+
+std::string Profiler::name(Object* fn) const {
+  if (fn->Type() == ObjectType::kBuiltIn) {
+    auto iter = builtin_names_.find(fn);
+    return iter != builtin_names_.end() ? iter->second : "builtin";
+  }
+  FunctionObject* function = static_cast<FunctionObject*>(fn);
+  const Token& token = function->body->token;
+  return (function->name.empty() ? "fn" : function->name.name()) + "@" + std::to_string(token.line) + ":" +
+         std::to_string(token.column);
+}
+
+size_t Profiler::enter(Object* fn, size_t parent, size_t* function) {
+  const void* key = fn;
+  if (fn->Type() == ObjectType::kFunction) {
+    key = static_cast<FunctionObject*>(fn)->body.get();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto id = ids_.find(key);
+  if (id == ids_.end()) {
+    id = ids_.emplace(key, functions_.size()).first;
+    functions_.emplace_back();
+    functions_.back().name = name(fn);
+  }
+  *function = id->second;
+  ++functions_[id->second].calls;
+  auto child = stacks_[parent].children.find(id->second);
+  if (child != stacks_[parent].children.end()) {
+    return child->second;
+  }
+  stacks_.emplace_back(id->second, parent);
+  stacks_[parent].children.emplace(id->second, stacks_.size() - 1);
+  return stacks_.size() - 1;
+}
+
+void Profiler::exit(size_t stack, int64_t inclusive_ns, int64_t exclusive_ns, bool outermost) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Function& function = functions_[stacks_[stack].function];
+  function.exclusive_ns += exclusive_ns;
+  if (outermost) {
+    function.inclusive_ns += inclusive_ns;
+  }
+  stacks_[stack].exclusive_ns += exclusive_ns;
+}
+
+void Profiler::WriteReport(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<const Function*> sorted;
+  for (auto& function : functions_) {
+    sorted.push_back(&function);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const Function* lhs, const Function* rhs) {
+    return lhs->exclusive_ns > rhs->exclusive_ns;
+  });
+  char line[64];
+  std::snprintf(line, sizeof(line), "%12s %12s %12s  ", "calls", "total ms", "self ms");
+  out << line << "function\n";
+  for (const Function* function : sorted) {
+    std::snprintf(line, sizeof(line), "%12llu %12.3f %12.3f  ", static_cast<unsigned long long>(function->calls),
+                  function->inclusive_ns / 1e6, function->exclusive_ns / 1e6);
+    out << line << function->name << '\n';
+  }
+}
+
+void Profiler::WriteCollapsed(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& child : stacks_[0].children) {
+    writeCollapsed(out, child.second, "");
+  }
+}
+
+void Profiler::writeCollapsed(std::ostream& out, size_t stack, const std::string& prefix) const {
+  std::string frames = prefix + functions_[stacks_[stack].function].name;
+  int64_t us = stacks_[stack].exclusive_ns / 1000;
+  if (us > 0) {
+    out << frames << ' ' << us << '\n';
+  }
+  for (auto& child : stacks_[stack].children) {
+    writeCollapsed(out, child.second, frames + ";");
+  }
+}
+
+void ProfileScope::start(Object* fn) {
+  caller_ = innermost;
+  bool nested = caller_ != nullptr && caller_->profiler_ == profiler_;
+  stack_ = profiler_->enter(fn, nested ? caller_->stack_ : 0, &function_);
+  if (active_calls.size() <= function_) {
+    active_calls.resize(function_ + 1);
+  }
+  ++active_calls[function_];
+  innermost = this;
+  start_ns_ = NowNs();
+}
+
+void ProfileScope::stop() {
+  int64_t inclusive_ns = NowNs() - start_ns_;
+  bool outermost = --active_calls[function_] == 0;
+  profiler_->exit(stack_, inclusive_ns, inclusive_ns - callees_ns_, outermost);
+  if (caller_ != nullptr && caller_->profiler_ == profiler_) {
+    caller_->callees_ns_ += inclusive_ns;
+  }
+  innermost = caller_;
+}
@@ -0,0 +1,114 @@
+#ifndef SRC_PROFILER_H_
+#define SRC_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "object.h"
+
+// Times every call made through ApplyFunction: script functions, keyed by
+// their function literal and named after the let binding and source
+// location (fib@3:18), and builtins, named as they are bound. For each it
+// counts calls and sums inclusive time, which counts a recursive function
+// once per outermost call, and exclusive time, which leaves out callees.
+// It also records the time spent in every distinct call stack, for flame
+// graphs.
+//
+// A profiler is installed process-wide and sees calls on every thread;
+// tasks and parallel builtins start their own stacks. Recording takes a
+// lock, so profiling slows evaluation down considerably.
+class Profiler {
+ public:
+  // builtins names the builtin objects calls may reach.
+  explicit Profiler(const BuiltInBindings& builtins);
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  static Profiler* Active() { return active_.load(std::memory_order_acquire); }
+  // Installs profiler, or stops profiling if it is nullptr. Calls in
+  // progress meanwhile are not recorded.
+  static void SetActive(Profiler* profiler) { active_.store(profiler, std::memory_order_release); }
+
+  // Functions sorted by exclusive time: calls, inclusive and exclusive
+  // milliseconds and the name.
+  void WriteReport(std::ostream& out) const;
+
+  // One line per call stack, "outer;inner microseconds", as flamegraph.pl
+  // and speedscope read it.
+  void WriteCollapsed(std::ostream& out) const;
+
+ private:
+  friend class ProfileScope;
+
+  struct Function {
+    std::string name;
+    uint64_t calls = 0;
+    int64_t inclusive_ns = 0;
+    int64_t exclusive_ns = 0;
+  };
+
+  // A node of the call tree: a function called by its parent's.
+  struct Stack {
+    Stack(size_t f, size_t p) : function(f), parent(p) {}
+
+    size_t function;
+    size_t parent;
+    int64_t exclusive_ns = 0;
+    std::map<size_t, size_t> children;
+  };
+
+  size_t enter(Object* fn, size_t parent, size_t* function);
+  void exit(size_t stack, int64_t inclusive_ns, int64_t exclusive_ns, bool outermost);
+  std::string name(Object* fn) const;
+  void writeCollapsed(std::ostream& out, size_t stack, const std::string& prefix) const;
+
+  static std::atomic<Profiler*> active_;
+
+  std::unordered_map<const Object*, std::string> builtin_names_;
+  mutable std::mutex mutex_;
+  // Keyed by the body of script functions, so every closure a function
+  // literal creates counts as one function, and by the object of builtins.
+  std::unordered_map<const void*, size_t> ids_;
+  std::vector<Function> functions_;
+  // stacks_[0] is the root, above the outermost calls of each thread.
+  std::vector<Stack> stacks_;
+};
+
+// Records the call of fn for its lifetime if a profiler is active.
+class ProfileScope {
+ public:
+  explicit ProfileScope(Object* fn) : profiler_(Profiler::Active()) {
+    if (profiler_ != nullptr) {
+      start(fn);
+    }
+  }
+  ~ProfileScope() {
+    if (profiler_ != nullptr) {
+      stop();
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  void start(Object* fn);
+  void stop();
+
+  Profiler* profiler_;
+  size_t stack_ = 0;
+  size_t function_ = 0;
+  int64_t start_ns_ = 0;
+  int64_t callees_ns_ = 0;
+  // The innermost call on this thread when this one started.
+  ProfileScope* caller_ = nullptr;
+};
+
+#endif  // SRC_PROFILER_H_
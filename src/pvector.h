@@ -0,0 +1,202 @@
+#ifndef SRC_PVECTOR_H_
+#define SRC_PVECTOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "budget.h"
+
+// An immutable vector with structural sharing, laid out as a 32-way trie
+// plus a tail leaf (the Clojure design). Lookups, updates and appends touch
+// O(log32 n) nodes; every version stays valid and shares all unchanged
+// nodes with the versions derived from it.
+//
+// Appending to the tail claims the next slot of the shared tail leaf when no
+// other version claimed it yet, so a chain of appends does not copy the tail
+// each time. Slots past a version's size are invisible to it.
+template <typename T>
+class PersistentVector {
+ public:
+  PersistentVector() : size_(0), shift_(kBits) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const T& operator[](size_t i) const {
+    return leafFor(i)->values[i & kMask];
+  }
+
+  PersistentVector push_back(T value) const {
+    size_t tail_len = size_ - tailOffset();
+    if (tail_len < kWidth) {
+      if (tail_ != nullptr) {
+        uint32_t expected = static_cast<uint32_t>(tail_len);
+        if (tail_->used.compare_exchange_strong(expected, expected + 1)) {
+          tail_->values[tail_len] = std::move(value);
+          return PersistentVector(size_ + 1, shift_, root_, tail_);
+        }
+      }
+      std::shared_ptr<Leaf> tail = newLeaf();
+      for (size_t i = 0; i < tail_len; ++i) {
+        tail->values[i] = tail_->values[i];
+      }
+      tail->values[tail_len] = std::move(value);
+      tail->used = static_cast<uint32_t>(tail_len + 1);
+      return PersistentVector(size_ + 1, shift_, root_, tail);
+    }
+
+    // The tail is full: move it into the trie and start a new one.
+    std::shared_ptr<Branch> root;
+    int shift = shift_;
+    if ((size_ >> kBits) > (static_cast<size_t>(1) << shift_)) {
+      root = newBranch();
+      root->children[0] = root_;
+      root->children[1] = newPath(shift_, tail_);
+      shift += kBits;
+    } else {
+      root = pushTail(shift_, root_.get(), tail_);
+    }
+    std::shared_ptr<Leaf> tail = newLeaf();
+    tail->values[0] = std::move(value);
+    tail->used = 1;
+    return PersistentVector(size_ + 1, shift, root, tail);
+  }
+
+  PersistentVector set(size_t i, T value) const {
+    size_t tail_offset = tailOffset();
+    if (i >= tail_offset) {
+      std::shared_ptr<Leaf> tail = newLeaf();
+      size_t tail_len = size_ - tail_offset;
+      for (size_t j = 0; j < tail_len; ++j) {
+        tail->values[j] = tail_->values[j];
+      }
+      tail->values[i - tail_offset] = std::move(value);
+      tail->used = static_cast<uint32_t>(tail_len);
+      return PersistentVector(size_, shift_, root_, tail);
+    }
+    return PersistentVector(size_, shift_, assoc(shift_, root_, i, std::move(value)), tail_);
+  }
+
+  // Calls f on the elements in [begin, end), one leaf at a time.
+  template <typename F>
+  void ForEach(size_t begin, size_t end, F f) const {
+    size_t i = begin;
+    while (i < end) {
+      const Leaf* leaf = leafFor(i);
+      size_t leaf_end = (i | kMask) + 1;
+      if (leaf_end > end) {
+        leaf_end = end;
+      }
+      for (; i < leaf_end; ++i) {
+        f(leaf->values[i & kMask]);
+      }
+    }
+  }
+
+ private:
+  static const int kBits = 5;
+  static const size_t kWidth = static_cast<size_t>(1) << kBits;
+  static const size_t kMask = kWidth - 1;
+
+  struct Leaf {
+    std::atomic<uint32_t> used{0};
+    T values[kWidth];
+  };
+
+  // Children of branches at level kBits are leaves, above that branches.
+  struct Branch {
+    std::shared_ptr<void> children[kWidth];
+  };
+
+  static std::shared_ptr<Leaf> newLeaf() {
+    ChargeBudget(sizeof(Leaf));
+    return std::make_shared<Leaf>();
+  }
+
+  static std::shared_ptr<Branch> newBranch() {
+    ChargeBudget(sizeof(Branch));
+    return std::make_shared<Branch>();
+  }
+
+  PersistentVector(size_t size, int shift, std::shared_ptr<Branch> root, std::shared_ptr<Leaf> tail)
+      : size_(size), shift_(shift), root_(std::move(root)), tail_(std::move(tail)) {}
+
+  size_t tailOffset() const {
+    return size_ < kWidth ? 0 : ((size_ - 1) >> kBits) << kBits;
+  }
+
+  const Leaf* leafFor(size_t i) const {
+    if (i >= tailOffset()) {
+      return tail_.get();
+    }
+    const void* node = root_.get();
+    for (int level = shift_; level > 0; level -= kBits) {
+      node = static_cast<const Branch*>(node)->children[(i >> level) & kMask].get();
+    }
+    return static_cast<const Leaf*>(node);
+  }
+
+  std::shared_ptr<Branch> pushTail(int level, const Branch* parent, std::shared_ptr<Leaf> tail) const {
+    std::shared_ptr<Branch> ret = newBranch();
+    if (parent != nullptr) {
+      for (size_t i = 0; i < kWidth; ++i) {
+        ret->children[i] = parent->children[i];
+      }
+    }
+    size_t index = ((size_ - 1) >> level) & kMask;
+    if (level == kBits) {
+      ret->children[index] = std::move(tail);
+    } else {
+      const Branch* child = parent != nullptr
+          ? static_cast<const Branch*>(parent->children[index].get()) : nullptr;
+      if (child != nullptr) {
+        ret->children[index] = pushTail(level - kBits, child, std::move(tail));
+      } else {
+        ret->children[index] = newPath(level - kBits, std::move(tail));
+      }
+    }
+    return ret;
+  }
+
+  static std::shared_ptr<void> newPath(int level, std::shared_ptr<Leaf> leaf) {
+    if (level == 0) {
+      return leaf;
+    }
+    std::shared_ptr<Branch> ret = newBranch();
+    ret->children[0] = newPath(level - kBits, std::move(leaf));
+    return ret;
+  }
+
+  static std::shared_ptr<Branch> assoc(int level, const std::shared_ptr<Branch>& node, size_t i, T value) {
+    std::shared_ptr<Branch> ret = newBranch();
+    for (size_t j = 0; j < kWidth; ++j) {
+      ret->children[j] = node->children[j];
+    }
+    size_t index = (i >> level) & kMask;
+    if (level == kBits) {
+      const Leaf* leaf = static_cast<const Leaf*>(node->children[index].get());
+      std::shared_ptr<Leaf> copy = newLeaf();
+      for (size_t j = 0; j < kWidth; ++j) {
+        copy->values[j] = leaf->values[j];
+      }
+      copy->values[i & kMask] = std::move(value);
+      copy->used = static_cast<uint32_t>(kWidth);
+      ret->children[index] = copy;
+    } else {
+      ret->children[index] = assoc(level - kBits,
+                                   std::static_pointer_cast<Branch>(node->children[index]),
+                                   i, std::move(value));
+    }
+    return ret;
+  }
+
+  size_t size_;
+  int shift_;
+  std::shared_ptr<Branch> root_;
+  std::shared_ptr<Leaf> tail_;
+};
+
+#endif  // SRC_PVECTOR_H_
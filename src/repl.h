@@ -4,40 +4,64 @@
 #include <iostream>
 #include <string>
 
-#include "lexer/lexer.h"
-#include "parser.h"
+#include "interpreter.h"
 
 const std::string PROMPT = ">> ";
 
-void Start(std::istream& in, std::ostream& out) {
-  std::shared_ptr<Environment> env = std::make_shared<Environment>();
+// Reads and evaluates one line at a time until the end of input.
+inline void Start(Interpreter& interpreter, std::istream& in, std::ostream& out) {
   while (true) {
-    out << PROMPT;
+    out << PROMPT << std::flush;
 
     std::string line;
-    getline(in, line);
-    if (line.empty()) {
+    if (!getline(in, line)) {
       return ;
     }
+    if (line.empty()) {
+      continue;
+    }
 
-    Lexer lexer(line);
-    // for (Token tok = lexer.NextToken(); tok.type != TokenType::kEOF; tok = lexer.NextToken()) {
-    //   out << static_cast<int>(tok.type) << " " << tok.literal << std::endl;
-    // }
-    Parser parser(&lexer);
-    std::shared_ptr<Program> program = parser.ParseProgram();
-    if (!parser.Errors().empty()) {
-      for (auto& str : parser.Errors()) {
-        std::cout << str << std::endl;
+    std::vector<std::string> errors;
+    std::shared_ptr<Program> program = interpreter.Parse(line, &errors);
+    if (program == nullptr) {
+      for (auto& str : errors) {
+        out << str << '\n';
       }
+      continue;
     }
-    // std::cout << program->String() << std::endl;
-    std::shared_ptr<Object> evalueted = program->Eval(env);
+    std::shared_ptr<Object> evalueted = interpreter.Run(program);
     if (evalueted != nullptr) {
-      std::cout << evalueted->Inspect() << std::endl;
+      out << evalueted->Inspect() << '\n';
     }
   }
 
 }
 
-#endif  // SRC_REPL_H_
\ No newline at end of file
+inline void Start(std::istream& in, std::ostream& out) {
+  Interpreter interpreter;
+  Start(interpreter, in, out);
+}
+
+// Parses source as one program and evaluates it, writing the value of each
+// top-level expression to out without a prompt. Parse and evaluation
+// errors go to err. Returns false on either. out is not flushed.
+inline bool RunScript(Interpreter& interpreter, const std::string& source, std::ostream& out, std::ostream& err) {
+  std::vector<std::string> errors;
+  std::shared_ptr<Program> program = interpreter.Parse(source, &errors);
+  if (program == nullptr) {
+    for (auto& str : errors) {
+      err << str << '\n';
+    }
+    return false;
+  }
+  std::shared_ptr<Object> result = interpreter.Run(program, [&out](const std::shared_ptr<Object>& value) {
+    out << value->Inspect() << '\n';
+  });
+  if (result != nullptr && result->Type() == ObjectType::kError) {
+    err << result->Inspect() << '\n';
+    return false;
+  }
+  return true;
+}
+
+#endif  // SRC_REPL_H_
@@ -0,0 +1,93 @@
+#include "script.h"
+
+Value::Value() : object_(std::make_shared<NullObject>()) {}
+
+Value::Value(int64_t value) : object_(std::make_shared<IntegerObject>(value)) {}
+
+Value::Value(double value) : object_(std::make_shared<FloatObject>(value)) {}
+
+Value::Value(bool value) : object_(std::make_shared<BooleanObject>(value)) {}
+
+Value::Value(std::string value) : object_(std::make_shared<StringObject>(std::move(value))) {}
+
+Value::Value(std::vector<Value> elements) {
+  std::shared_ptr<ArrayObject> arr = std::make_shared<ArrayObject>();
+  for (auto& elem : elements) {
+    arr->Append(std::move(elem.object_));
+  }
+  object_ = std::move(arr);
+  root_ = HostRoot::Make(object_);
+}
+
+Value::Value(const std::vector<int64_t>& elements) {
+  ArrayObject::Ints ints = ArrayObject::Ints::Uninitialized(elements.size());
+  std::copy(elements.begin(), elements.end(), ints.MutableData());
+  object_ = std::make_shared<ArrayObject>(ints);
+}
+
+Value::Value(const std::vector<double>& elements) {
+  ArrayObject::Floats floats = ArrayObject::Floats::Uninitialized(elements.size());
+  std::copy(elements.begin(), elements.end(), floats.MutableData());
+  object_ = std::make_shared<ArrayObject>(floats);
+}
+
+Value::Value(std::shared_ptr<Object> object)
+    : object_(object != nullptr ? std::move(object) : std::make_shared<NullObject>()),
+      root_(HostRoot::Make(object_)) {}
+
+Value Value::Hash(const std::vector<std::pair<Value, Value>>& entries) {
+  std::shared_ptr<HashObject> hash = std::make_shared<HashObject>();
+  hash->table.Reserve(entries.size());
+  for (auto& entry : entries) {
+    hash->table.Set(entry.first.object_, entry.second.object_);
+  }
+  return Value(std::move(hash));
+}
+
+int64_t Value::AsInteger() const {
+  return IsInteger() ? static_cast<IntegerObject*>(object_.get())->value : 0;
+}
+
+double Value::AsFloat() const {
+  if (IsFloat()) {
+    return static_cast<FloatObject*>(object_.get())->value;
+  }
+  return static_cast<double>(AsInteger());
+}
+
+bool Value::AsBoolean() const {
+  return IsBoolean() && static_cast<BooleanObject*>(object_.get())->value;
+}
+
+std::string_view Value::AsString() const {
+  return IsString() ? static_cast<StringObject*>(object_.get())->View() : std::string_view();
+}
+
+const std::string& Value::ErrorMessage() const {
+  static const std::string kEmpty;
+  return IsError() ? static_cast<ErrorObject*>(object_.get())->message : kEmpty;
+}
+
+size_t Value::Size() const {
+  if (IsArray()) {
+    return static_cast<ArrayObject*>(object_.get())->Size();
+  }
+  if (IsHash()) {
+    return static_cast<HashObject*>(object_.get())->table.size();
+  }
+  return 0;
+}
+
+Value Value::operator[](size_t i) const {
+  if (!IsArray() || i >= Size()) {
+    return Value();
+  }
+  return Value(static_cast<ArrayObject*>(object_.get())->At(i));
+}
+
+Value Value::Get(const Value& key) const {
+  if (!IsHash()) {
+    return Value();
+  }
+  return Value(static_cast<HashObject*>(object_.get())->table.Find(key.object_));
+}
@@ -0,0 +1,88 @@
+#ifndef SRC_SCRIPT_H_
+#define SRC_SCRIPT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+#include "gc.h"
+
+// The host's handle on a script value. Values convert from and to C++ types
+// directly, without printing and parsing. Accessors for the wrong type
+// return an empty result (0, false, an empty string or a null value).
+// A value holding closures roots their scopes, so they stay callable for
+// as long as their interpreter lives.
+class Value {
+ public:
+  Value();
+  Value(int value) : Value(static_cast<int64_t>(value)) {}
+  Value(int64_t value);
+  Value(double value);
+  Value(bool value);
+  Value(const char* value) : Value(std::string(value)) {}
+  Value(std::string value);
+  Value(std::vector<Value> elements);
+  // Unboxed arrays, as the array builtins produce them.
+  Value(const std::vector<int64_t>& elements);
+  Value(const std::vector<double>& elements);
+  explicit Value(std::shared_ptr<Object> object);
+
+  static Value Hash(const std::vector<std::pair<Value, Value>>& entries);
+
+  ObjectType Type() const { return object_->Type(); }
+  bool IsNull() const { return Type() == ObjectType::kNull; }
+  bool IsInteger() const { return Type() == ObjectType::kInteger; }
+  bool IsFloat() const { return Type() == ObjectType::kFloat; }
+  bool IsBoolean() const { return Type() == ObjectType::kBoolean; }
+  bool IsString() const { return Type() == ObjectType::kString; }
+  bool IsArray() const { return Type() == ObjectType::kArray; }
+  bool IsHash() const { return Type() == ObjectType::kHash; }
+  bool IsError() const { return Type() == ObjectType::kError; }
+
+  int64_t AsInteger() const;
+  // Integers convert.
+  double AsFloat() const;
+  bool AsBoolean() const;
+  // Valid while this value is alive.
+  std::string_view AsString() const;
+  const std::string& ErrorMessage() const;
+
+  // Elements of an array or entries of a hash.
+  size_t Size() const;
+  Value operator[](size_t i) const;
+  // Null if the key is absent.
+  Value Get(const Value& key) const;
+
+  const std::shared_ptr<Object>& object() const { return object_; }
+
+ private:
+  std::shared_ptr<Object> object_;
+  std::shared_ptr<HostRoot> root_;
+};
+
+using Inputs = std::vector<std::pair<std::string, Value>>;
+
+// A parsed script, ready to be called any number of times. Parsing already
+// resolves builtins, including host functions the compiling interpreter
+// defined, and interns names and string literals, so a call only
+// evaluates. That ties a script to the interpreter that compiled it, which
+// refuses calls from others; each interpreter compiles its own.
+class Script {
+ public:
+  Script(std::shared_ptr<Program> program, uint64_t interpreter)
+      : program_(std::move(program)), interpreter_(interpreter) {}
+
+  const std::shared_ptr<Program>& program() const { return program_; }
+  // The id of the compiling interpreter.
+  uint64_t interpreter() const { return interpreter_; }
+
+ private:
+  std::shared_ptr<Program> program_;
+  uint64_t interpreter_;
+};
+
+#endif  // SRC_SCRIPT_H_
@@ -0,0 +1,226 @@
+#include "builtins.h"
+
+#include <string>
+#include <utility>
+
+#include "ast.h"
+
+// iter turns an array or an integer range into a lazy sequence; lazy_map,
+// lazy_filter and take add stages to it and collect (or reduce) runs the
+// whole pipeline as one loop. The stage builtins accept arrays and channels
+// too and wrap them on the fly.
+
+namespace {
+
+class ArraySource : public SequenceObject::Source {
+ public:
+  explicit ArraySource(std::shared_ptr<ArrayObject> array) : array_(std::move(array)) {}
+
+  std::unique_ptr<SequenceObject::Cursor> Open() const override {
+    return std::unique_ptr<SequenceObject::Cursor>(new Cursor(array_.get()));
+  }
+
+  void ForEachReference(const std::function<void(Object*)>& f) const override {
+    f(array_.get());
+  }
+
+ private:
+  class Cursor : public SequenceObject::Cursor {
+   public:
+    explicit Cursor(const ArrayObject* array) : array_(array), index_(0) {}
+
+    bool Next(std::shared_ptr<Object>* value) override {
+      if (index_ == array_->Size()) {
+        return false;
+      }
+      *value = array_->At(index_++);
+      return true;
+    }
+
+   private:
+    const ArrayObject* array_;
+    size_t index_;
+  };
+
+  std::shared_ptr<ArrayObject> array_;
+};
+
+class RangeSource : public SequenceObject::Source {
+ public:
+  RangeSource(int64_t begin, int64_t end, int64_t step) : begin_(begin), end_(end), step_(step) {}
+
+  std::unique_ptr<SequenceObject::Cursor> Open() const override {
+    return std::unique_ptr<SequenceObject::Cursor>(new Cursor(begin_, end_, step_));
+  }
+
+ private:
+  class Cursor : public SequenceObject::Cursor {
+   public:
+    Cursor(int64_t begin, int64_t end, int64_t step) : next_(begin), end_(end), step_(step) {}
+
+    bool Next(std::shared_ptr<Object>* value) override {
+      if (step_ > 0 ? next_ >= end_ : next_ <= end_) {
+        return false;
+      }
+      *value = std::make_shared<IntegerObject>(next_);
+      // Stop instead of overflowing past the end. Distances between int64s
+      // only fit in unsigned arithmetic, as in range.
+      uint64_t left = step_ > 0 ? static_cast<uint64_t>(end_) - static_cast<uint64_t>(next_)
+                                : static_cast<uint64_t>(next_) - static_cast<uint64_t>(end_);
+      uint64_t stride = step_ > 0 ? static_cast<uint64_t>(step_) : 0 - static_cast<uint64_t>(step_);
+      if (left <= stride) {
+        next_ = end_;
+      } else {
+        next_ = static_cast<int64_t>(static_cast<uint64_t>(next_) + static_cast<uint64_t>(step_));
+      }
+      return true;
+    }
+
+   private:
+    int64_t next_;
+    int64_t end_;
+    int64_t step_;
+  };
+
+  int64_t begin_;
+  int64_t end_;
+  int64_t step_;
+};
+
+// Receives from a channel until it is closed. Every pass continues where
+// the previous one stopped.
+class ChannelSource : public SequenceObject::Source {
+ public:
+  explicit ChannelSource(std::shared_ptr<ChannelObject> channel) : channel_(std::move(channel)) {}
+
+  std::unique_ptr<SequenceObject::Cursor> Open() const override {
+    return std::unique_ptr<SequenceObject::Cursor>(new Cursor(channel_.get()));
+  }
+
+ private:
+  class Cursor : public SequenceObject::Cursor {
+   public:
+    explicit Cursor(ChannelObject* channel) : channel_(channel) {}
+
+    bool Next(std::shared_ptr<Object>* value) override {
+      std::string error = channel_->Recv(value);
+      if (!error.empty()) {
+        *value = std::make_shared<ErrorObject>(error);
+      }
+      return *value != nullptr;
+    }
+
+   private:
+    ChannelObject* channel_;
+  };
+
+  std::shared_ptr<ChannelObject> channel_;
+};
+
+// Views an array, channel or sequence argument as a sequence.
+std::shared_ptr<Object> ToSequence(const std::shared_ptr<Object>& obj, const std::string& name,
+                                   std::shared_ptr<SequenceObject>* out) {
+  if (obj->Type() == ObjectType::kSequence) {
+    *out = std::static_pointer_cast<SequenceObject>(obj);
+    return nullptr;
+  }
+  if (obj->Type() == ObjectType::kArray) {
+    *out = std::make_shared<SequenceObject>(
+        std::make_shared<ArraySource>(std::static_pointer_cast<ArrayObject>(obj)));
+    return nullptr;
+  }
+  if (obj->Type() == ObjectType::kChannel) {
+    *out = std::make_shared<SequenceObject>(
+        std::make_shared<ChannelSource>(std::static_pointer_cast<ChannelObject>(obj)));
+    return nullptr;
+  }
+  return std::make_shared<ErrorObject>("argument to " + name + " must be Array, Channel or Sequence, got " + ObjectTypeToString(obj->Type()));
+}
+
+std::shared_ptr<Object> AddStage(const std::vector<std::shared_ptr<Object>>& args, const std::string& name,
+                                 SequenceObject::Stage::Kind kind) {
+  if (args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<SequenceObject> seq;
+  std::shared_ptr<Object> err = ToSequence(args[0], name, &seq);
+  if (err != nullptr) {
+    return err;
+  }
+  if (args[1]->Type() != ObjectType::kFunction && args[1]->Type() != ObjectType::kBuiltIn) {
+    return std::make_shared<ErrorObject>("operation of " + name + " must be function, got " + ObjectTypeToString(args[1]->Type()));
+  }
+  return seq->With({kind, args[1], 0});
+}
+
+}  // namespace
+
+// iter(arr), iter(ch), or iter(end), iter(begin, end) and iter(begin, end, step) for a
+// lazy integer range.
+std::shared_ptr<Object> BuiltInIter(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() == 1 && args[0]->Type() != ObjectType::kInteger) {
+    std::shared_ptr<SequenceObject> seq;
+    std::shared_ptr<Object> err = ToSequence(args[0], "iter", &seq);
+    if (err != nullptr) {
+      return err;
+    }
+    return seq;
+  }
+  if (args.empty() || args.size() > 3) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  int64_t bounds[3] = {0, 0, 1};
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i]->Type() != ObjectType::kInteger) {
+      return std::make_shared<ErrorObject>("arguments to iter must be Integer, got " + ObjectTypeToString(args[i]->Type()));
+    }
+    bounds[args.size() == 1 ? 1 : i] = static_cast<IntegerObject*>(args[i].get())->value;
+  }
+  if (bounds[2] == 0) {
+    return std::make_shared<ErrorObject>("step of iter must not be 0");
+  }
+  return std::make_shared<SequenceObject>(std::make_shared<RangeSource>(bounds[0], bounds[1], bounds[2]));
+}
+
+std::shared_ptr<Object> BuiltInLazyMap(std::vector<std::shared_ptr<Object>> args) {
+  return AddStage(args, "lazy_map", SequenceObject::Stage::kMap);
+}
+
+std::shared_ptr<Object> BuiltInLazyFilter(std::vector<std::shared_ptr<Object>> args) {
+  return AddStage(args, "lazy_filter", SequenceObject::Stage::kFilter);
+}
+
+std::shared_ptr<Object> BuiltInTake(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<SequenceObject> seq;
+  std::shared_ptr<Object> err = ToSequence(args[0], "take", &seq);
+  if (err != nullptr) {
+    return err;
+  }
+  if (args[1]->Type() != ObjectType::kInteger) {
+    return std::make_shared<ErrorObject>("count of take must be Integer, got " + ObjectTypeToString(args[1]->Type()));
+  }
+  return seq->With({SequenceObject::Stage::kTake, nullptr, static_cast<IntegerObject*>(args[1].get())->value});
+}
+
+std::shared_ptr<Object> BuiltInCollect(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 1) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  std::shared_ptr<SequenceObject> seq;
+  std::shared_ptr<Object> err = ToSequence(args[0], "collect", &seq);
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+  err = seq->Run([&ret](std::shared_ptr<Object> value) {
+    ret->Append(std::move(value));
+    return true;
+  });
+  if (err != nullptr) {
+    return err;
+  }
+  return ret;
+}
@@ -0,0 +1,943 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Layout, in native byte order (the fingerprint covers it):
+//
+//   magic "GOKUSNAP", u32 version, u64 fingerprint, u32 environment count
+//   environments: u32 outer (kNone for none), u32 binding count, bindings
+//   binding: string name, object
+//
+// Environment 0 is the global one. Objects and syntax nodes are written
+// inline, in pre-order; each gets the next id of its kind when first
+// written and is written as a reference to that id afterwards, which keeps
+// shared values and function bodies shared. Strings are a u32 length and
+// the bytes.
+
+namespace {
+
+const char kMagic[8] = {'G', 'O', 'K', 'U', 'S', 'N', 'A', 'P'};
+// Bump whenever the encoding changes.
+const uint32_t kVersion = 2;
+const uint32_t kNone = 0xffffffff;
+// Strings at least this long stay in the mapping when loaded.
+const size_t kMinMappedString = 16;
+// Deeper nesting than this is taken for a corrupt file.
+const int kMaxDepth = 10000;
+
+enum class ObjectTag : uint8_t {
+  kRef,
+  kNull,
+  kInteger,
+  kFloat,
+  kBoolean,
+  kString,
+  kError,
+  kBuiltIn,
+  kInts,
+  kFloats,
+  kArray,
+  kHash,
+  kFunction,
+};
+
+enum class NodeTag : uint8_t {
+  kNone,
+  kRef,
+  kIdentifier,
+  kInteger,
+  kFloat,
+  kString,
+  kBoolean,
+  kPrefix,
+  kInfix,
+  kLet,
+  kReturn,
+  kExpression,
+  kBlock,
+  kIf,
+  kFunction,
+  kCall,
+  kArray,
+  kIndex,
+  kSlice,
+  kHash,
+};
+
+// Changes whenever this build could not read another build's snapshots the
+// same way: a different byte order or pointer size, token or object types,
+// or core builtins.
+uint64_t Fingerprint() {
+  std::string description = "goku";
+  uint32_t order = 0x01020304;
+  description.append(reinterpret_cast<const char*>(&order), sizeof(order));
+  description += std::to_string(sizeof(void*));
+  description += std::to_string(static_cast<int>(TokenType::kString));
+  description += std::to_string(static_cast<int>(ObjectType::kChannel));
+  for (auto& pair : BuiltInTable) {
+    description += ",";
+    description += pair.first;
+  }
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : description) {
+    hash = (hash ^ c) * 1099511628211ull;
+  }
+  return hash;
+}
+
+class Writer {
+ public:
+  explicit Writer(const BuiltInBindings& builtins) {
+    for (auto& pair : builtins) {
+      builtin_names_.emplace(pair.second.get(), pair.first);
+    }
+  }
+
+  // Returns an empty string on success.
+  std::string Write(const std::shared_ptr<Environment>& globals, std::string* out) {
+    envId(globals.get());
+    for (size_t i = 0; i < envs_.size() && error_.empty(); ++i) {
+      Environment* env = envs_[i];
+      putU32(i == 0 || env->outer == nullptr ? kNone : envId(env->outer.get()));
+      putU32(env->objects.size());
+      for (auto& binding : env->objects) {
+        putString(binding.first.name());
+        putObject(binding.second.get());
+      }
+    }
+    if (!error_.empty()) {
+      return error_;
+    }
+    out->assign(kMagic, sizeof(kMagic));
+    append(out, kVersion);
+    append(out, Fingerprint());
+    append(out, static_cast<uint32_t>(envs_.size()));
+    *out += buffer_;
+    return "";
+  }
+
+ private:
+  template <typename T>
+  static void append(std::string* out, T value) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void putU8(uint8_t value) { append(&buffer_, value); }
+  void putU32(uint32_t value) { append(&buffer_, value); }
+  void putU64(uint64_t value) { append(&buffer_, value); }
+
+  void putString(std::string_view value) {
+    putU32(value.size());
+    buffer_ += value;
+  }
+
+  void putToken(const Token& token) {
+    putU8(static_cast<uint8_t>(token.type));
+    putString(token.literal);
+    putU32(token.line);
+    putU32(token.column);
+  }
+
+  void putSymbol(Symbol symbol) { putString(symbol.empty() ? std::string_view() : symbol.name()); }
+
+  uint32_t envId(Environment* env) {
+    auto iter = env_ids_.find(env);
+    if (iter != env_ids_.end()) {
+      return iter->second;
+    }
+    env_ids_.emplace(env, envs_.size());
+    envs_.push_back(env);
+    return envs_.size() - 1;
+  }
+
+  void putObject(Object* obj) {
+    if (obj == nullptr || obj->Type() == ObjectType::kNull) {
+      putU8(static_cast<uint8_t>(ObjectTag::kNull));
+      return;
+    }
+    auto iter = object_ids_.find(obj);
+    if (iter != object_ids_.end()) {
+      putU8(static_cast<uint8_t>(ObjectTag::kRef));
+      putU32(iter->second);
+      return;
+    }
+    object_ids_.emplace(obj, object_ids_.size());
+    switch (obj->Type()) {
+    case ObjectType::kInteger:
+      putU8(static_cast<uint8_t>(ObjectTag::kInteger));
+      putU64(static_cast<IntegerObject*>(obj)->value);
+      break;
+    case ObjectType::kFloat: {
+      putU8(static_cast<uint8_t>(ObjectTag::kFloat));
+      append(&buffer_, static_cast<FloatObject*>(obj)->value);
+      break;
+    }
+    case ObjectType::kBoolean:
+      putU8(static_cast<uint8_t>(ObjectTag::kBoolean));
+      putU8(static_cast<BooleanObject*>(obj)->value);
+      break;
+    case ObjectType::kString:
+      putU8(static_cast<uint8_t>(ObjectTag::kString));
+      putString(static_cast<StringObject*>(obj)->View());
+      break;
+    case ObjectType::kError:
+      putU8(static_cast<uint8_t>(ObjectTag::kError));
+      putString(static_cast<ErrorObject*>(obj)->message);
+      break;
+    case ObjectType::kBuiltIn: {
+      auto name = builtin_names_.find(obj);
+      if (name == builtin_names_.end()) {
+        fail("cannot snapshot a builtin without a name");
+        return;
+      }
+      putU8(static_cast<uint8_t>(ObjectTag::kBuiltIn));
+      putString(name->second);
+      break;
+    }
+    case ObjectType::kArray:
+      putArray(static_cast<ArrayObject*>(obj));
+      break;
+    case ObjectType::kHash: {
+      HashObject* hash = static_cast<HashObject*>(obj);
+      putU8(static_cast<uint8_t>(ObjectTag::kHash));
+      putU32(hash->table.size());
+      for (auto& entry : hash->table) {
+        putObject(entry.key.get());
+        putObject(entry.value.get());
+      }
+      break;
+    }
+    case ObjectType::kFunction: {
+      FunctionObject* fn = static_cast<FunctionObject*>(obj);
+      putU8(static_cast<uint8_t>(ObjectTag::kFunction));
+      putU32(fn->parameters.size());
+      for (auto& param : fn->parameters) {
+        putIdentifier(param);
+      }
+      putNode(fn->body.get());
+      putU32(envId(fn->env.get()));
+      putSymbol(fn->name);
+      break;
+    }
+    default:
+      fail("cannot snapshot " + ObjectTypeToString(obj->Type()));
+      break;
+    }
+  }
+
+  void putArray(ArrayObject* arr) {
+    if (arr->IsInts()) {
+      putU8(static_cast<uint8_t>(ObjectTag::kInts));
+      putU32(arr->ints.size());
+      buffer_.append(reinterpret_cast<const char*>(arr->ints.data()), arr->ints.size() * sizeof(int64_t));
+    } else if (arr->IsFloats()) {
+      putU8(static_cast<uint8_t>(ObjectTag::kFloats));
+      putU32(arr->floats.size());
+      buffer_.append(reinterpret_cast<const char*>(arr->floats.data()), arr->floats.size() * sizeof(double));
+    } else {
+      putU8(static_cast<uint8_t>(ObjectTag::kArray));
+      putU32(arr->Size());
+      arr->ForEach([this](const std::shared_ptr<Object>& elem) { putObject(elem.get()); });
+    }
+  }
+
+  void putIdentifier(const Identifier& ident) {
+    putToken(ident.token);
+    putString(ident.value);
+    putU8(ident.builtin != nullptr);
+  }
+
+  void putTag(NodeTag tag) { putU8(static_cast<uint8_t>(tag)); }
+
+  void putNode(Node* node) {
+    if (node == nullptr) {
+      putTag(NodeTag::kNone);
+      return;
+    }
+    auto iter = node_ids_.find(node);
+    if (iter != node_ids_.end()) {
+      putTag(NodeTag::kRef);
+      putU32(iter->second);
+      return;
+    }
+    node_ids_.emplace(node, node_ids_.size());
+    if (auto ident = dynamic_cast<Identifier*>(node)) {
+      putTag(NodeTag::kIdentifier);
+      putIdentifier(*ident);
+    } else if (auto lit = dynamic_cast<IntegerLiteral*>(node)) {
+      putTag(NodeTag::kInteger);
+      putToken(lit->token);
+      putU64(lit->value);
+    } else if (auto lit = dynamic_cast<FloatLiteral*>(node)) {
+      putTag(NodeTag::kFloat);
+      putToken(lit->token);
+      append(&buffer_, lit->value);
+    } else if (auto lit = dynamic_cast<StringLiteral*>(node)) {
+      putTag(NodeTag::kString);
+      putToken(lit->token);
+      putString(lit->value);
+    } else if (auto lit = dynamic_cast<Boolean*>(node)) {
+      putTag(NodeTag::kBoolean);
+      putToken(lit->token);
+      putU8(lit->value);
+    } else if (auto exp = dynamic_cast<PrefixExpression*>(node)) {
+      putTag(NodeTag::kPrefix);
+      putToken(exp->token);
+      putString(exp->op);
+      putNode(exp->right.get());
+    } else if (auto exp = dynamic_cast<InfixExpression*>(node)) {
+      putTag(NodeTag::kInfix);
+      putToken(exp->token);
+      putString(exp->op);
+      putNode(exp->left.get());
+      putNode(exp->right.get());
+    } else if (auto stmt = dynamic_cast<LetStatement*>(node)) {
+      putTag(NodeTag::kLet);
+      putToken(stmt->token);
+      putNode(stmt->name.get());
+      putNode(stmt->value.get());
+    } else if (auto stmt = dynamic_cast<ReturnStatement*>(node)) {
+      putTag(NodeTag::kReturn);
+      putToken(stmt->token);
+      putNode(stmt->ret_value.get());
+    } else if (auto stmt = dynamic_cast<ExpressionStatement*>(node)) {
+      putTag(NodeTag::kExpression);
+      putToken(stmt->token);
+      putNode(stmt->expression.get());
+    } else if (auto block = dynamic_cast<BlockStatement*>(node)) {
+      putTag(NodeTag::kBlock);
+      putToken(block->token);
+      putU32(block->statements_.size());
+      for (auto& stmt : block->statements_) {
+        putNode(stmt.get());
+      }
+    } else if (auto exp = dynamic_cast<IfExpression*>(node)) {
+      putTag(NodeTag::kIf);
+      putToken(exp->token);
+      putNode(exp->condition.get());
+      putNode(exp->consequence.get());
+      putNode(exp->alternative.get());
+    } else if (auto lit = dynamic_cast<FunctionLiteral*>(node)) {
+      putTag(NodeTag::kFunction);
+      putToken(lit->token);
+      putU32(lit->parameters.size());
+      for (auto& param : lit->parameters) {
+        putIdentifier(param);
+      }
+      putNode(lit->body.get());
+      putSymbol(lit->name);
+    } else if (auto exp = dynamic_cast<CallExpression*>(node)) {
+      putTag(NodeTag::kCall);
+      putToken(exp->token);
+      putNode(exp->function.get());
+      putU32(exp->arguments.size());
+      for (auto& arg : exp->arguments) {
+        putNode(arg.get());
+      }
+    } else if (auto lit = dynamic_cast<ArrayLiteral*>(node)) {
+      putTag(NodeTag::kArray);
+      putToken(lit->token);
+      putU32(lit->elements.size());
+      for (auto& elem : lit->elements) {
+        putNode(elem.get());
+      }
+    } else if (auto exp = dynamic_cast<IndexExpression*>(node)) {
+      putTag(NodeTag::kIndex);
+      putToken(exp->token);
+      putNode(exp->left.get());
+      putNode(exp->right.get());
+    } else if (auto exp = dynamic_cast<SliceExpression*>(node)) {
+      putTag(NodeTag::kSlice);
+      putToken(exp->token);
+      putNode(exp->left.get());
+      putNode(exp->begin.get());
+      putNode(exp->end.get());
+    } else if (auto lit = dynamic_cast<HashLiteral*>(node)) {
+      putTag(NodeTag::kHash);
+      putToken(lit->token);
+      putU32(lit->pairs.size());
+      for (auto& pair : lit->pairs) {
+        putNode(pair.first.get());
+        putNode(pair.second.get());
+      }
+    } else {
+      fail("cannot snapshot syntax node " + node->String());
+    }
+  }
+
+  void fail(const std::string& error) {
+    if (error_.empty()) {
+      error_ = error;
+    }
+  }
+
+  std::unordered_map<Object*, std::string> builtin_names_;
+  std::unordered_map<Environment*, uint32_t> env_ids_;
+  std::vector<Environment*> envs_;
+  std::unordered_map<Object*, uint32_t> object_ids_;
+  std::unordered_map<Node*, uint32_t> node_ids_;
+  std::string buffer_;
+  std::string error_;
+};
+
+class Reader {
+ public:
+  Reader(std::shared_ptr<MappedFile> file, const BuiltInBindings& builtins)
+      : file_(std::move(file)), builtins_(builtins), pos_(file_->data()), end_(pos_ + file_->size()) {}
+
+  // Returns an empty string on success.
+  std::string Read(const std::shared_ptr<Environment>& globals) {
+    if (remaining() < sizeof(kMagic) || std::memcmp(pos_, kMagic, sizeof(kMagic)) != 0) {
+      return "not a goku snapshot";
+    }
+    pos_ += sizeof(kMagic);
+    uint32_t version = getU32();
+    uint64_t fingerprint = get<uint64_t>();
+    if (!error_.empty() || version != kVersion || fingerprint != Fingerprint()) {
+      return "snapshot was written by an incompatible build";
+    }
+    uint32_t count = getU32();
+    if (count == 0 || count > remaining()) {
+      return "corrupt snapshot";
+    }
+    envs_.resize(count);
+    envs_[0] = globals;
+    for (uint32_t i = 0; i < count && error_.empty(); ++i) {
+      std::shared_ptr<Environment> env = envAt(i);
+      uint32_t outer = getU32();
+      if (i != 0 && outer != kNone) {
+        env->outer = envAt(outer);
+        if (outer == 0) {
+          global_scopes_.push_back(env);
+        }
+      }
+      uint32_t bindings = getCount();
+      for (uint32_t j = 0; j < bindings && error_.empty(); ++j) {
+        Symbol name = Symbol::Intern(std::string(getString()));
+        env->Set(name, getObject(0));
+      }
+    }
+    if (error_.empty() && pos_ != end_) {
+      fail("corrupt snapshot");
+    }
+    return error_;
+  }
+
+  // Moves what Read put in the scratch globals into the real ones:
+  // the bindings, unless globals already has them, and the closures and
+  // scopes that were saved inside the global scope, so they see globals
+  // defined after loading.
+  void Commit(const std::shared_ptr<Environment>& globals) {
+    for (auto& binding : envs_[0]->objects) {
+      globals->Set(binding.first, binding.second);
+    }
+    for (auto& function : global_closures_) {
+      function->env = globals;
+    }
+    for (auto& env : global_scopes_) {
+      env->outer = globals;
+    }
+  }
+
+ private:
+  size_t remaining() const { return end_ - pos_; }
+
+  template <typename T>
+  T get() {
+    T value = T();
+    if (remaining() < sizeof(T)) {
+      fail("corrupt snapshot");
+      return value;
+    }
+    std::memcpy(&value, pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return value;
+  }
+
+  uint8_t getU8() { return get<uint8_t>(); }
+  uint32_t getU32() { return get<uint32_t>(); }
+
+  // A count of items of at least one byte each.
+  uint32_t getCount() {
+    uint32_t count = getU32();
+    if (count > remaining()) {
+      fail("corrupt snapshot");
+      return 0;
+    }
+    return count;
+  }
+
+  std::string_view getString() {
+    uint32_t size = getU32();
+    if (size > remaining()) {
+      fail("corrupt snapshot");
+      return std::string_view();
+    }
+    std::string_view ret(pos_, size);
+    pos_ += size;
+    return ret;
+  }
+
+  Token getToken() {
+    Token token;
+    token.type = static_cast<TokenType>(getU8());
+    token.literal = std::string(getString());
+    token.line = getU32();
+    token.column = getU32();
+    return token;
+  }
+
+  Symbol getSymbol() {
+    std::string_view name = getString();
+    return name.empty() ? Symbol() : Symbol::Intern(std::string(name));
+  }
+
+  std::shared_ptr<Environment> envAt(uint32_t id) {
+    if (id >= envs_.size()) {
+      fail("corrupt snapshot");
+      return envs_[0];
+    }
+    if (envs_[id] == nullptr) {
+      envs_[id] = std::make_shared<Environment>();
+    }
+    return envs_[id];
+  }
+
+  std::shared_ptr<Object> getObject(int depth) {
+    ObjectTag tag = static_cast<ObjectTag>(getU8());
+    if (!error_.empty() || depth > kMaxDepth) {
+      fail("corrupt snapshot");
+      return std::make_shared<NullObject>();
+    }
+    if (tag == ObjectTag::kNull) {
+      return std::make_shared<NullObject>();
+    }
+    if (tag == ObjectTag::kRef) {
+      uint32_t id = getU32();
+      if (id >= objects_.size() || objects_[id] == nullptr) {
+        fail("corrupt snapshot");
+        return std::make_shared<NullObject>();
+      }
+      return objects_[id];
+    }
+    size_t id = objects_.size();
+    objects_.emplace_back();
+    std::shared_ptr<Object> ret;
+    switch (tag) {
+    case ObjectTag::kInteger:
+      ret = std::make_shared<IntegerObject>(get<int64_t>());
+      break;
+    case ObjectTag::kFloat:
+      ret = std::make_shared<FloatObject>(get<double>());
+      break;
+    case ObjectTag::kBoolean:
+      ret = std::make_shared<BooleanObject>(getU8() != 0);
+      break;
+    case ObjectTag::kString: {
+      std::string_view value = getString();
+      if (value.size() >= kMinMappedString) {
+        ret = std::make_shared<StringObject>(file_, value.data(), value.size());
+      } else {
+        ret = std::make_shared<StringObject>(std::string(value));
+      }
+      break;
+    }
+    case ObjectTag::kError:
+      ret = std::make_shared<ErrorObject>(std::string(getString()));
+      break;
+    case ObjectTag::kBuiltIn:
+      ret = builtin(std::string(getString()));
+      break;
+    case ObjectTag::kInts:
+      ret = std::make_shared<ArrayObject>(getTyped<ArrayObject::Ints>());
+      break;
+    case ObjectTag::kFloats:
+      ret = std::make_shared<ArrayObject>(getTyped<ArrayObject::Floats>());
+      break;
+    case ObjectTag::kArray: {
+      std::shared_ptr<ArrayObject> arr = std::make_shared<ArrayObject>();
+      uint32_t size = getCount();
+      for (uint32_t i = 0; i < size && error_.empty(); ++i) {
+        arr->Append(getObject(depth + 1));
+      }
+      ret = std::move(arr);
+      break;
+    }
+    case ObjectTag::kHash: {
+      std::shared_ptr<HashObject> hash = std::make_shared<HashObject>();
+      uint32_t size = getCount();
+      hash->table.Reserve(size);
+      for (uint32_t i = 0; i < size && error_.empty(); ++i) {
+        std::shared_ptr<Object> key = getObject(depth + 1);
+        hash->table.Set(std::move(key), getObject(depth + 1));
+      }
+      ret = std::move(hash);
+      break;
+    }
+    case ObjectTag::kFunction: {
+      std::vector<Identifier> parameters(getCount());
+      for (auto& param : parameters) {
+        getIdentifier(&param);
+      }
+      std::shared_ptr<BlockStatement> body = getNode<BlockStatement>(depth + 1);
+      uint32_t env_id = getU32();
+      std::shared_ptr<Environment> env = envAt(env_id);
+      Symbol name = getSymbol();
+      if (body == nullptr) {
+        fail("corrupt snapshot");
+        return std::make_shared<NullObject>();
+      }
+      std::shared_ptr<FunctionObject> function = std::make_shared<FunctionObject>(parameters, body, env, name);
+      if (env_id == 0) {
+        global_closures_.push_back(function);
+      }
+      ret = std::move(function);
+      break;
+    }
+    default:
+      fail("corrupt snapshot");
+      return std::make_shared<NullObject>();
+    }
+    objects_[id] = ret;
+    return ret;
+  }
+
+  template <typename Vector>
+  Vector getTyped() {
+    using T = typename Vector::value_type;
+    uint32_t size = getU32();
+    if (size > remaining() / sizeof(T)) {
+      fail("corrupt snapshot");
+      return Vector();
+    }
+    Vector ret = Vector::Uninitialized(size);
+    std::memcpy(ret.MutableData(), pos_, size * sizeof(T));
+    pos_ += size * sizeof(T);
+    return ret;
+  }
+
+  std::shared_ptr<BuiltInObject> builtin(const std::string& name) {
+    auto iter = builtins_.find(name);
+    if (iter == builtins_.end()) {
+      fail("snapshot needs builtin " + name + ", which is not loaded");
+      return nullptr;
+    }
+    return iter->second;
+  }
+
+  void getIdentifier(Identifier* ident) {
+    ident->token = getToken();
+    ident->value = std::string(getString());
+    ident->symbol = Symbol::Intern(ident->value);
+    if (getU8() != 0) {
+      ident->builtin = builtin(ident->value);
+    }
+  }
+
+  // Reads a node that must be a T or absent.
+  template <typename T>
+  std::shared_ptr<T> getNode(int depth) {
+    std::shared_ptr<Node> node = getNode(depth);
+    std::shared_ptr<T> ret = std::dynamic_pointer_cast<T>(node);
+    if (node != nullptr && ret == nullptr) {
+      fail("corrupt snapshot");
+    }
+    return ret;
+  }
+
+  std::shared_ptr<Node> getNode(int depth) {
+    NodeTag tag = static_cast<NodeTag>(getU8());
+    if (!error_.empty() || depth > kMaxDepth) {
+      fail("corrupt snapshot");
+      return nullptr;
+    }
+    if (tag == NodeTag::kNone) {
+      return nullptr;
+    }
+    if (tag == NodeTag::kRef) {
+      uint32_t id = getU32();
+      if (id >= nodes_.size() || nodes_[id] == nullptr) {
+        fail("corrupt snapshot");
+        return nullptr;
+      }
+      return nodes_[id];
+    }
+    size_t id = nodes_.size();
+    nodes_.emplace_back();
+    std::shared_ptr<Node> ret;
+    ++depth;
+    switch (tag) {
+    case NodeTag::kIdentifier: {
+      std::shared_ptr<Identifier> ident = std::make_shared<Identifier>();
+      getIdentifier(ident.get());
+      ret = ident;
+      break;
+    }
+    case NodeTag::kInteger: {
+      std::shared_ptr<IntegerLiteral> lit = std::make_shared<IntegerLiteral>();
+      lit->token = getToken();
+      lit->value = get<int64_t>();
+      ret = lit;
+      break;
+    }
+    case NodeTag::kFloat: {
+      std::shared_ptr<FloatLiteral> lit = std::make_shared<FloatLiteral>();
+      lit->token = getToken();
+      lit->value = get<double>();
+      ret = lit;
+      break;
+    }
+    case NodeTag::kString: {
+      std::shared_ptr<StringLiteral> lit = std::make_shared<StringLiteral>();
+      lit->token = getToken();
+      lit->value = std::string(getString());
+      lit->object = strings_.Get(lit->value);
+      ret = lit;
+      break;
+    }
+    case NodeTag::kBoolean: {
+      std::shared_ptr<Boolean> lit = std::make_shared<Boolean>();
+      lit->token = getToken();
+      lit->value = getU8() != 0;
+      ret = lit;
+      break;
+    }
+    case NodeTag::kPrefix: {
+      std::shared_ptr<PrefixExpression> exp = std::make_shared<PrefixExpression>();
+      exp->token = getToken();
+      exp->op = std::string(getString());
+      exp->right = required<Expression>(depth);
+      ret = exp;
+      break;
+    }
+    case NodeTag::kInfix: {
+      std::shared_ptr<InfixExpression> exp = std::make_shared<InfixExpression>();
+      exp->token = getToken();
+      exp->op = std::string(getString());
+      exp->left = required<Expression>(depth);
+      exp->right = required<Expression>(depth);
+      ret = exp;
+      break;
+    }
+    case NodeTag::kLet: {
+      std::shared_ptr<LetStatement> stmt = std::make_shared<LetStatement>();
+      stmt->token = getToken();
+      stmt->name = required<Identifier>(depth);
+      stmt->value = required<Expression>(depth);
+      ret = stmt;
+      break;
+    }
+    case NodeTag::kReturn: {
+      std::shared_ptr<ReturnStatement> stmt = std::make_shared<ReturnStatement>();
+      stmt->token = getToken();
+      stmt->ret_value = required<Expression>(depth);
+      ret = stmt;
+      break;
+    }
+    case NodeTag::kExpression: {
+      std::shared_ptr<ExpressionStatement> stmt = std::make_shared<ExpressionStatement>();
+      stmt->token = getToken();
+      stmt->expression = required<Expression>(depth);
+      ret = stmt;
+      break;
+    }
+    case NodeTag::kBlock: {
+      std::shared_ptr<BlockStatement> block = std::make_shared<BlockStatement>();
+      block->token = getToken();
+      block->statements_.resize(getCount());
+      for (auto& stmt : block->statements_) {
+        stmt = required<Statement>(depth);
+      }
+      ret = block;
+      break;
+    }
+    case NodeTag::kIf: {
+      std::shared_ptr<IfExpression> exp = std::make_shared<IfExpression>();
+      exp->token = getToken();
+      exp->condition = required<Expression>(depth);
+      exp->consequence = required<BlockStatement>(depth);
+      exp->alternative = getNode<BlockStatement>(depth);
+      ret = exp;
+      break;
+    }
+    case NodeTag::kFunction: {
+      std::shared_ptr<FunctionLiteral> lit = std::make_shared<FunctionLiteral>();
+      lit->token = getToken();
+      lit->parameters.resize(getCount());
+      for (auto& param : lit->parameters) {
+        getIdentifier(&param);
+      }
+      lit->body = required<BlockStatement>(depth);
+      lit->name = getSymbol();
+      ret = lit;
+      break;
+    }
+    case NodeTag::kCall: {
+      std::shared_ptr<CallExpression> exp = std::make_shared<CallExpression>();
+      exp->token = getToken();
+      exp->function = required<Expression>(depth);
+      exp->arguments.resize(getCount());
+      for (auto& arg : exp->arguments) {
+        arg = required<Expression>(depth);
+      }
+      ret = exp;
+      break;
+    }
+    case NodeTag::kArray: {
+      std::shared_ptr<ArrayLiteral> lit = std::make_shared<ArrayLiteral>();
+      lit->token = getToken();
+      lit->elements.resize(getCount());
+      for (auto& elem : lit->elements) {
+        elem = required<Expression>(depth);
+      }
+      ret = lit;
+      break;
+    }
+    case NodeTag::kIndex: {
+      std::shared_ptr<IndexExpression> exp = std::make_shared<IndexExpression>();
+      exp->token = getToken();
+      exp->left = required<Expression>(depth);
+      exp->right = required<Expression>(depth);
+      ret = exp;
+      break;
+    }
+    case NodeTag::kSlice: {
+      std::shared_ptr<SliceExpression> exp = std::make_shared<SliceExpression>();
+      exp->token = getToken();
+      exp->left = required<Expression>(depth);
+      exp->begin = getNode<Expression>(depth);
+      exp->end = getNode<Expression>(depth);
+      ret = exp;
+      break;
+    }
+    case NodeTag::kHash: {
+      std::shared_ptr<HashLiteral> lit = std::make_shared<HashLiteral>();
+      lit->token = getToken();
+      lit->pairs.resize(getCount());
+      for (auto& pair : lit->pairs) {
+        pair.first = required<Expression>(depth);
+        pair.second = required<Expression>(depth);
+      }
+      ret = lit;
+      break;
+    }
+    default:
+      fail("corrupt snapshot");
+      return nullptr;
+    }
+    nodes_[id] = ret;
+    return ret;
+  }
+
+  // Reads a node that must be a T.
+  template <typename T>
+  std::shared_ptr<T> required(int depth) {
+    std::shared_ptr<T> ret = getNode<T>(depth);
+    if (ret == nullptr) {
+      fail("corrupt snapshot");
+    }
+    return ret;
+  }
+
+  void fail(const std::string& error) {
+    if (error_.empty()) {
+      error_ = error;
+    }
+  }
+
+  std::shared_ptr<MappedFile> file_;
+  const BuiltInBindings& builtins_;
+  const char* pos_;
+  const char* end_;
+  std::vector<std::shared_ptr<Environment>> envs_;
+  std::vector<std::shared_ptr<Object>> objects_;
+  std::vector<std::shared_ptr<Node>> nodes_;
+  StringLiterals strings_;
+  // What refers to environment 0, patched by Commit.
+  std::vector<std::shared_ptr<FunctionObject>> global_closures_;
+  std::vector<std::shared_ptr<Environment>> global_scopes_;
+  std::string error_;
+};
+
+}  // namespace
+
+std::string SaveSnapshot(const std::shared_ptr<Environment>& globals, const BuiltInBindings& builtins,
+                         const std::string& path) {
+  std::string content;
+  std::string error = Writer(builtins).Write(globals, &content);
+  if (!error.empty()) {
+    return error;
+  }
+  // Processes that loaded the snapshot read long strings straight from
+  // their mapping of the file, so it must not change under them: the new
+  // one is written next to it and renamed over it.
+  static std::atomic<uint64_t> next_temp{0};
+  std::string temp = path + ".tmp." + std::to_string(getpid()) + "." +
+                     std::to_string(next_temp.fetch_add(1, std::memory_order_relaxed));
+  int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+  if (fd < 0) {
+    return "cannot open " + temp + ": " + std::strerror(errno);
+  }
+  std::FILE* file = fdopen(fd, "wb");
+  if (file == nullptr) {
+    close(fd);
+    unlink(temp.c_str());
+    return "cannot open " + temp + ": " + std::strerror(errno);
+  }
+  bool ok = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+  if (std::fclose(file) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    int saved = errno;
+    unlink(temp.c_str());
+    return "cannot write " + path + ": " + std::strerror(saved);
+  }
+  if (rename(temp.c_str(), path.c_str()) != 0) {
+    int saved = errno;
+    unlink(temp.c_str());
+    return "cannot write " + path + ": " + std::strerror(saved);
+  }
+  return "";
+}
+
+std::string LoadSnapshot(const std::string& path, const BuiltInBindings& builtins,
+                         const std::shared_ptr<Environment>& globals) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return "cannot open " + path + ": " + std::strerror(errno);
+  }
+  struct stat st;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    return "not a goku snapshot";
+  }
+  std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(data, st.st_size);
+  // Parse into a scratch environment first, so a corrupt file leaves
+  // globals untouched.
+  std::shared_ptr<Environment> loaded = std::make_shared<Environment>();
+  Reader reader(std::move(file), builtins);
+  std::string error = reader.Read(loaded);
+  if (!error.empty()) {
+    return error;
+  }
+  reader.Commit(globals);
+  return "";
+}
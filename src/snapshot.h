@@ -0,0 +1,33 @@
+#ifndef SRC_SNAPSHOT_H_
+#define SRC_SNAPSHOT_H_
+
+#include <memory>
+#include <string>
+
+#include "ast.h"
+
+// A snapshot is a binary image of a global environment: its bindings and
+// every object, closure, environment and function body reachable from them.
+// Loading maps the file and rebuilds the objects and syntax trees in one
+// pass, without parsing or evaluating anything; long strings keep pointing
+// into the mapping.
+//
+// A snapshot starts with a format version and a fingerprint of the build
+// (its token and object types and core builtins) and is refused if either
+// differs. Builtins are saved by name, so extension builtins a snapshot
+// refers to must be loaded again. Tasks, channels, sequences and string
+// builders can not be saved.
+
+// Writes a new file and renames it over path, so processes that loaded
+// the old one keep reading it intact. Returns an empty string on success,
+// otherwise why saving failed.
+std::string SaveSnapshot(const std::shared_ptr<Environment>& globals, const BuiltInBindings& builtins,
+                         const std::string& path);
+
+// Adds the snapshot's bindings to globals; bindings globals already has
+// win. Restored closures are rebound to globals, so they see bindings made
+// after loading. Returns an empty string on success, otherwise why loading failed.
+std::string LoadSnapshot(const std::string& path, const BuiltInBindings& builtins,
+                         const std::shared_ptr<Environment>& globals);
+
+#endif  // SRC_SNAPSHOT_H_
@@ -0,0 +1,265 @@
+#include "builtins.h"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "ast.h"
+
+// String builtins scan with memchr and memmem, which libc implements with
+// SIMD, and size their output buffers before writing. Substrings they return
+// (split pieces, trim) are slices sharing the argument's memory. Offsets and
+// lengths count bytes, like len.
+
+namespace {
+
+std::shared_ptr<Object> CheckStrings(const std::vector<std::shared_ptr<Object>>& args, const std::string& name,
+                                     size_t min_args, size_t max_args) {
+  if (args.size() < min_args || args.size() > max_args) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  for (auto& arg : args) {
+    if (arg->Type() != ObjectType::kString) {
+      return std::make_shared<ErrorObject>("arguments to " + name + " must be String, got " + ObjectTypeToString(arg->Type()));
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<StringObject> AsString(const std::shared_ptr<Object>& obj) {
+  return std::static_pointer_cast<StringObject>(obj);
+}
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Position of needle in haystack at or after from, or npos.
+size_t Find(std::string_view haystack, std::string_view needle, size_t from) {
+  if (from > haystack.size()) {
+    return std::string_view::npos;
+  }
+  if (needle.empty()) {
+    return from;
+  }
+  const void* found;
+  if (needle.size() == 1) {
+    found = std::memchr(haystack.data() + from, needle[0], haystack.size() - from);
+  } else {
+    found = memmem(haystack.data() + from, haystack.size() - from, needle.data(), needle.size());
+  }
+  return found == nullptr ? std::string_view::npos : static_cast<const char*>(found) - haystack.data();
+}
+
+// Maps ASCII letters through a branch-free loop the compiler vectorizes.
+// Returns the argument itself if nothing changes.
+std::shared_ptr<Object> ChangeCase(const std::vector<std::shared_ptr<Object>>& args, const std::string& name,
+                                   char first, char last) {
+  std::shared_ptr<Object> err = CheckStrings(args, name, 1, 1);
+  if (err != nullptr) {
+    return err;
+  }
+  std::string_view value = AsString(args[0])->View();
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(value.data());
+  size_t changes = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    changes += static_cast<unsigned char>(in[i] - first) <= static_cast<unsigned char>(last - first);
+  }
+  if (changes == 0) {
+    return args[0];
+  }
+  std::string ret(value.size(), '\0');
+  unsigned char* out = reinterpret_cast<unsigned char*>(&ret[0]);
+  for (size_t i = 0; i < value.size(); ++i) {
+    unsigned char c = in[i];
+    out[i] = c ^ ((static_cast<unsigned char>(c - first) <= static_cast<unsigned char>(last - first)) << 5);
+  }
+  return std::make_shared<StringObject>(std::move(ret));
+}
+
+}  // namespace
+
+// split(s) splits on runs of whitespace, dropping empty pieces; split(s,
+// sep) splits on every occurrence of sep.
+std::shared_ptr<Object> BuiltInSplit(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckStrings(args, "split", 1, 2);
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<StringObject> str = AsString(args[0]);
+  std::string_view value = str->View();
+  std::shared_ptr<ArrayObject> ret = std::make_shared<ArrayObject>();
+  if (args.size() == 1) {
+    size_t i = 0;
+    while (true) {
+      while (i < value.size() && IsSpace(value[i])) {
+        ++i;
+      }
+      if (i == value.size()) {
+        break;
+      }
+      size_t begin = i;
+      while (i < value.size() && !IsSpace(value[i])) {
+        ++i;
+      }
+      ret->Append(SliceString(str, begin, i - begin));
+    }
+    return ret;
+  }
+  std::string_view sep = AsString(args[1])->View();
+  if (sep.empty()) {
+    return std::make_shared<ErrorObject>("separator of split must not be empty");
+  }
+  size_t begin = 0;
+  while (true) {
+    size_t found = Find(value, sep, begin);
+    if (found == std::string_view::npos) {
+      ret->Append(SliceString(str, begin, value.size() - begin));
+      return ret;
+    }
+    ret->Append(SliceString(str, begin, found - begin));
+    begin = found + sep.size();
+  }
+}
+
+// join(arr, sep) concatenates an array of strings into one buffer sized up
+// front.
+std::shared_ptr<Object> BuiltInJoin(std::vector<std::shared_ptr<Object>> args) {
+  if (args.size() != 2) {
+    return std::make_shared<ErrorObject>("wrong number of arguments");
+  }
+  if (args[0]->Type() != ObjectType::kArray) {
+    return std::make_shared<ErrorObject>("argument to join must be Array, got " + ObjectTypeToString(args[0]->Type()));
+  }
+  if (args[1]->Type() != ObjectType::kString) {
+    return std::make_shared<ErrorObject>("separator of join must be String, got " + ObjectTypeToString(args[1]->Type()));
+  }
+  ArrayObject* arr = static_cast<ArrayObject*>(args[0].get());
+  std::string_view sep = AsString(args[1])->View();
+  size_t size = arr->Size() > 0 ? sep.size() * (arr->Size() - 1) : 0;
+  std::shared_ptr<Object> err;
+  arr->ForEach([&](const std::shared_ptr<Object>& elem) {
+    if (elem->Type() != ObjectType::kString) {
+      if (err == nullptr) {
+        err = std::make_shared<ErrorObject>("elements of join must be String, got " + ObjectTypeToString(elem->Type()));
+      }
+      return;
+    }
+    size += static_cast<StringObject*>(elem.get())->Length();
+  });
+  if (err != nullptr) {
+    return err;
+  }
+  std::string ret;
+  ret.reserve(size);
+  bool first = true;
+  // All elements are strings, so the array is generic or empty.
+  arr->elements.ForEach(arr->begin, arr->end, [&](const std::shared_ptr<Object>& elem) {
+    if (!first) {
+      ret += sep;
+    }
+    first = false;
+    ret += static_cast<StringObject*>(elem.get())->View();
+  });
+  return std::make_shared<StringObject>(std::move(ret));
+}
+
+// find(s, sub) or find(s, sub, from) is the byte offset of the first match,
+// or -1.
+std::shared_ptr<Object> BuiltInFind(std::vector<std::shared_ptr<Object>> args) {
+  int64_t from = 0;
+  if (args.size() == 3) {
+    if (args[2]->Type() != ObjectType::kInteger) {
+      return std::make_shared<ErrorObject>("start of find must be Integer, got " + ObjectTypeToString(args[2]->Type()));
+    }
+    from = static_cast<IntegerObject*>(args[2].get())->value;
+    if (from < 0) {
+      return std::make_shared<ErrorObject>("start of find must not be negative");
+    }
+    args.pop_back();
+  }
+  std::shared_ptr<Object> err = CheckStrings(args, "find", 2, 2);
+  if (err != nullptr) {
+    return err;
+  }
+  size_t found = Find(AsString(args[0])->View(), AsString(args[1])->View(), from);
+  return std::make_shared<IntegerObject>(found == std::string_view::npos ? -1 : static_cast<int64_t>(found));
+}
+
+// replace(s, old, new) replaces every occurrence of old. The matches are
+// counted first so the result is written into a buffer of its final size.
+std::shared_ptr<Object> BuiltInReplace(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckStrings(args, "replace", 3, 3);
+  if (err != nullptr) {
+    return err;
+  }
+  std::string_view value = AsString(args[0])->View();
+  std::string_view from = AsString(args[1])->View();
+  std::string_view to = AsString(args[2])->View();
+  if (from.empty()) {
+    return std::make_shared<ErrorObject>("pattern of replace must not be empty");
+  }
+  size_t count = 0;
+  for (size_t pos = Find(value, from, 0); pos != std::string_view::npos; pos = Find(value, from, pos + from.size())) {
+    ++count;
+  }
+  if (count == 0) {
+    return args[0];
+  }
+  std::string ret;
+  ret.reserve(value.size() - count * from.size() + count * to.size());
+  size_t begin = 0;
+  for (size_t pos = Find(value, from, 0); pos != std::string_view::npos; pos = Find(value, from, begin)) {
+    ret.append(value.data() + begin, pos - begin);
+    ret += to;
+    begin = pos + from.size();
+  }
+  ret.append(value.data() + begin, value.size() - begin);
+  return std::make_shared<StringObject>(std::move(ret));
+}
+
+std::shared_ptr<Object> BuiltInStartsWith(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckStrings(args, "starts_with", 2, 2);
+  if (err != nullptr) {
+    return err;
+  }
+  std::string_view value = AsString(args[0])->View();
+  std::string_view prefix = AsString(args[1])->View();
+  return std::make_shared<BooleanObject>(value.substr(0, prefix.size()) == prefix);
+}
+
+std::shared_ptr<Object> BuiltInEndsWith(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckStrings(args, "ends_with", 2, 2);
+  if (err != nullptr) {
+    return err;
+  }
+  std::string_view value = AsString(args[0])->View();
+  std::string_view suffix = AsString(args[1])->View();
+  return std::make_shared<BooleanObject>(value.size() >= suffix.size() &&
+                                         value.substr(value.size() - suffix.size()) == suffix);
+}
+
+std::shared_ptr<Object> BuiltInTrim(std::vector<std::shared_ptr<Object>> args) {
+  std::shared_ptr<Object> err = CheckStrings(args, "trim", 1, 1);
+  if (err != nullptr) {
+    return err;
+  }
+  std::shared_ptr<StringObject> str = AsString(args[0]);
+  std::string_view value = str->View();
+  size_t begin = 0, end = value.size();
+  while (begin < end && IsSpace(value[begin])) {
+    ++begin;
+  }
+  while (end > begin && IsSpace(value[end - 1])) {
+    --end;
+  }
+  return SliceString(str, begin, end - begin);
+}
+
+std::shared_ptr<Object> BuiltInUpper(std::vector<std::shared_ptr<Object>> args) {
+  return ChangeCase(args, "upper", 'a', 'z');
+}
+
+std::shared_ptr<Object> BuiltInLower(std::vector<std::shared_ptr<Object>> args) {
+  return ChangeCase(args, "lower", 'A', 'Z');
+}
@@ -0,0 +1,29 @@
+#include "symbol.h"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+Symbol Symbol::Intern(const std::string& name) {
+  // Interning happens while parsing, never on the evaluation path. The table
+  // is shared by every interpreter in the process and almost every lookup
+  // finds an existing entry, so hits only take a shared lock.
+  static std::shared_mutex mutex;
+  static std::unordered_map<std::string, std::unique_ptr<Entry>> table;
+
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iter = table.find(name);
+    if (iter != table.end()) {
+      return Symbol(iter->second.get());
+    }
+  }
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  auto iter = table.find(name);
+  if (iter == table.end()) {
+    std::unique_ptr<Entry> entry(new Entry{name, std::hash<std::string>()(name)});
+    iter = table.emplace(name, std::move(entry)).first;
+  }
+  return Symbol(iter->second.get());
+}
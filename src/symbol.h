@@ -0,0 +1,45 @@
+#ifndef SRC_SYMBOL_H_
+#define SRC_SYMBOL_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// An interned name. Every distinct string maps to exactly one entry in a
+// process-wide table, so symbols compare by pointer and carry their hash.
+// Entries are never freed, so only names are interned (identifiers and
+// bindings), never string data; the table grows with the distinct names
+// programs use, not with the number of programs or their inputs.
+class Symbol {
+ public:
+  Symbol() : entry_(nullptr) {}
+
+  static Symbol Intern(const std::string& name);
+
+  const std::string& name() const { return entry_->name; }
+  size_t hash() const { return entry_->hash; }
+
+  bool empty() const { return entry_ == nullptr; }
+
+  bool operator==(Symbol other) const { return entry_ == other.entry_; }
+  bool operator!=(Symbol other) const { return entry_ != other.entry_; }
+
+ private:
+  struct Entry {
+    std::string name;
+    size_t hash;
+  };
+
+  explicit Symbol(const Entry* entry) : entry_(entry) {}
+
+  const Entry* entry_;
+};
+
+namespace std {
+template <>
+struct hash<Symbol> {
+  size_t operator()(Symbol symbol) const noexcept { return symbol.hash(); }
+};
+}  // namespace std
+
+#endif  // SRC_SYMBOL_H_
@@ -0,0 +1,212 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <system_error>
+
+namespace {
+
+// Index of the pool queue owned by the current thread, or -1.
+thread_local int current_queue = -1;
+thread_local ThreadPool* current_pool = nullptr;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+  // Without workers, tasks still queue for the threads waiting on them.
+  for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+    queues_.emplace_back(new Queue());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back([this, i]() { run(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  spare_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  for (auto& thread : spares_) {
+    thread.join();
+  }
+}
+
+ThreadPool& ThreadPool::Default() {
+  static ThreadPool* pool = []() {
+    size_t threads = std::thread::hardware_concurrency();
+    const char* env = std::getenv("GOKU_THREADS");
+    if (env != nullptr) {
+      threads = std::strtoul(env, nullptr, 10);
+    }
+    // The thread waiting for a parallel call works too.
+    return new ThreadPool(threads > 1 ? threads - 1 : 0);
+  }();
+  return *pool;
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  size_t index = (current_pool == this && current_queue >= 0)
+      ? static_cast<size_t>(current_queue)
+      : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  bool wake_spare;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pending_;
+    wake_spare = working_spares_ < blocked_;
+  }
+  cv_.notify_one();
+  if (wake_spare) {
+    spare_cv_.notify_one();
+  }
+}
+
+bool ThreadPool::take(size_t index, std::function<void()>* task) {
+  bool owner = index < queues_.size();
+  if (owner) {
+    Queue& own = *queues_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      *task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --pending_;
+      return true;
+    }
+  }
+  for (size_t i = owner ? 1 : 0; i < queues_.size(); ++i) {
+    Queue& victim = *queues_[(index + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      *task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --pending_;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(size_t index) {
+  current_queue = static_cast<int>(index);
+  current_pool = this;
+  while (true) {
+    std::function<void()> task;
+    if (take(index, &task)) {
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return stop_ || pending_.load() > 0; });
+    if (stop_) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::runSpare() {
+  current_pool = this;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      spare_cv_.wait(lock, [this]() { return stop_ || (pending_.load() > 0 && working_spares_ < blocked_); });
+      if (stop_) {
+        return;
+      }
+      ++working_spares_;
+    }
+    std::function<void()> task;
+    if (take(queues_.size(), &task)) {
+      task();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    --working_spares_;
+  }
+}
+
+bool ThreadPool::BeginBlocking() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (blocked_ == kMaxBlocked) {
+    return false;
+  }
+  if (spares_.size() == blocked_) {
+    try {
+      spares_.emplace_back([this]() { runSpare(); });
+    } catch (const std::system_error&) {
+      return false;
+    }
+  }
+  ++blocked_;
+  spare_cv_.notify_one();
+  return true;
+}
+
+void ThreadPool::EndBlocking() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  --blocked_;
+}
+
+void ThreadPool::ParallelFor(size_t n, const std::function<void(size_t, size_t)>& fn) {
+  if (n == 0) {
+    return;
+  }
+  // A few chunks per thread balance uneven work without much overhead.
+  size_t chunks = threads_.empty() ? 1 : (threads_.size() + 1) * 4;
+  if (chunks > n) {
+    chunks = n;
+  }
+  if (chunks <= 1) {
+    fn(0, n);
+    return;
+  }
+  // Chunks go to whichever thread claims them first. A queued task finding
+  // none left returns without touching fn, so it may outlive this call.
+  struct Loop {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+  std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+  loop->remaining.store(chunks, std::memory_order_relaxed);
+  size_t chunk_size = n / chunks;
+  size_t extra = n % chunks;
+  auto work = [loop, &fn, chunks, chunk_size, extra]() {
+    size_t ran = 0;
+    for (size_t i; (i = loop->next.fetch_add(1, std::memory_order_relaxed)) < chunks; ++ran) {
+      size_t begin = i * chunk_size + std::min(i, extra);
+      fn(begin, begin + chunk_size + (i < extra ? 1 : 0));
+    }
+    if (ran != 0 && loop->remaining.fetch_sub(ran, std::memory_order_acq_rel) == ran) {
+      std::lock_guard<std::mutex> lock(loop->mutex);
+      loop->done.notify_all();
+    }
+  };
+  for (size_t i = 1; i < chunks; ++i) {
+    Submit(work);
+  }
+  work();
+  if (loop->remaining.load(std::memory_order_acquire) == 0) {
+    return;
+  }
+  if (BeginBlocking()) {
+    {
+      std::unique_lock<std::mutex> lock(loop->mutex);
+      loop->done.wait(lock, [&loop]() { return loop->remaining.load(std::memory_order_acquire) == 0; });
+    }
+    EndBlocking();
+  } else {
+    while (loop->remaining.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef SRC_THREAD_POOL_H_
+#define SRC_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing thread pool. Every worker owns a deque: it pushes and
+// pops its own tasks at the back and steals from the front of the others
+// when it runs dry. Threads waiting for tasks to finish only run work of
+// their own and otherwise sleep with a spare worker in their place (see
+// BeginBlocking), so neither nested parallel calls nor tasks that block
+// can deadlock the pool.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // The process-wide pool, sized by GOKU_THREADS or the number of cores.
+  static ThreadPool& Default();
+
+  size_t Size() const { return threads_.size(); }
+
+  // Queues a task. Even a pool without workers never runs it inline: it
+  // waits for a spare worker standing in for a blocked thread.
+  void Submit(std::function<void()> task);
+
+  // Calls fn(begin, end) over consecutive chunks covering [0, n) and
+  // returns once all calls finished. The calling thread takes part, but
+  // only in this loop's chunks.
+  void ParallelFor(size_t n, const std::function<void(size_t, size_t)>& fn);
+
+  // Bracket a wait for another thread's progress, such as a blocked
+  // channel operation, on any thread. Meanwhile a spare worker runs
+  // pending tasks in the waiting thread's place, so waits never tie up the
+  // threads the tasks they wait for need. Spares are started on demand and
+  // kept for later waits. BeginBlocking returns false, and the wait must
+  // not happen, once kMaxBlocked threads are waiting.
+  bool BeginBlocking();
+  void EndBlocking();
+
+  static const size_t kMaxBlocked = 1024;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void run(size_t index);
+  void runSpare();
+  // Takes from the queue index, if the thread owns one, or steals.
+  bool take(size_t index, std::function<void()>* task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_{0};
+  std::atomic<size_t> pending_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  // Guarded by mutex_. Spares own no queue and only run tasks while fewer
+  // of them do than threads are blocked.
+  std::vector<std::thread> spares_;
+  std::condition_variable spare_cv_;
+  size_t blocked_ = 0;
+  size_t working_spares_ = 0;
+};
+
+#endif  // SRC_THREAD_POOL_H_
@@ -0,0 +1,81 @@
+#ifndef SRC_TYPED_ARRAY_H_
+#define SRC_TYPED_ARRAY_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "budget.h"
+
+// An immutable, unboxed vector of plain values: a [begin, end) view into a
+// shared fixed-capacity buffer. Appending claims the buffer's next free slot
+// when the view ends exactly there and no other version took it, so chains
+// of appends are amortized O(1) while every version stays valid. Otherwise
+// the visible elements are copied into a buffer of twice the size.
+template <typename T>
+class TypedVector {
+ public:
+  using value_type = T;
+
+  TypedVector() : begin_(0), end_(0) {}
+
+  // A fresh vector of size elements to be filled through MutableData()
+  // before it is shared.
+  static TypedVector Uninitialized(size_t size, size_t capacity = 0) {
+    ReserveBudget(std::max(size, capacity) * sizeof(T));
+    std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>(std::max(size, capacity));
+    buffer->used = size;
+    return TypedVector(buffer, 0, size);
+  }
+
+  size_t size() const { return end_ - begin_; }
+  bool empty() const { return end_ == begin_; }
+
+  const T* data() const {
+    return buffer_ == nullptr ? nullptr : buffer_->values.get() + begin_;
+  }
+
+  T* MutableData() {
+    return buffer_ == nullptr ? nullptr : buffer_->values.get() + begin_;
+  }
+
+  T operator[](size_t i) const { return buffer_->values[begin_ + i]; }
+
+  TypedVector push_back(T value) const {
+    if (buffer_ != nullptr && end_ < buffer_->capacity) {
+      size_t expected = end_;
+      if (buffer_->used.compare_exchange_strong(expected, end_ + 1)) {
+        buffer_->values[end_] = value;
+        return TypedVector(buffer_, begin_, end_ + 1);
+      }
+    }
+    size_t n = size();
+    TypedVector ret = Uninitialized(n + 1, n < 8 ? 16 : 2 * n);
+    std::copy(data(), data() + n, ret.MutableData());
+    ret.MutableData()[n] = value;
+    return ret;
+  }
+
+  TypedVector slice(size_t begin, size_t end) const {
+    return TypedVector(buffer_, begin_ + begin, begin_ + end);
+  }
+
+ private:
+  struct Buffer {
+    explicit Buffer(size_t c) : used(0), capacity(c), values(new T[c]) {}
+
+    std::atomic<size_t> used;
+    size_t capacity;
+    std::unique_ptr<T[]> values;
+  };
+
+  TypedVector(std::shared_ptr<Buffer> buffer, size_t begin, size_t end)
+      : buffer_(std::move(buffer)), begin_(begin), end_(end) {}
+
+  std::shared_ptr<Buffer> buffer_;
+  size_t begin_;
+  size_t end_;
+};
+
+#endif  // SRC_TYPED_ARRAY_H_
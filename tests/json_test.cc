@@ -0,0 +1,139 @@
+// Checks json_parse against the JSON grammar, including escapes that
+// straddle the parser's 64-byte blocks, and that json_stringify output
+// parses back to the same text.
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace {
+
+int failures = 0;
+
+class Json {
+ public:
+  Json() {
+    std::vector<std::string> errors;
+    parse_ = interpreter_.Compile("json_parse(text)", &errors);
+    round_trip_ = interpreter_.Compile("json_stringify(json_parse(text))", &errors);
+  }
+
+  Value Parse(const std::string& text) { return interpreter_.Call(*parse_, {{"text", text}}); }
+  Value RoundTrip(const std::string& text) { return interpreter_.Call(*round_trip_, {{"text", text}}); }
+
+ private:
+  Interpreter interpreter_;
+  std::shared_ptr<const Script> parse_;
+  std::shared_ptr<const Script> round_trip_;
+};
+
+void ExpectString(Json& json, const std::string& text, const std::string& expected) {
+  Value value = json.Parse(text);
+  if (!value.IsString() || value.AsString() != expected) {
+    std::cerr << text << ": got " << value.object()->Inspect() << ", want \"" << expected << "\"" << std::endl;
+    ++failures;
+  }
+}
+
+// The last element of the array text parses to.
+void ExpectLast(Json& json, const std::string& text, const std::string& expected) {
+  Value value = json.Parse(text);
+  if (!value.IsArray() || value.Size() == 0 || value[value.Size() - 1].AsString() != expected) {
+    std::cerr << text << ": got " << value.object()->Inspect() << ", want \"" << expected << "\" last"
+              << std::endl;
+    ++failures;
+  }
+}
+
+void ExpectRejected(Json& json, const std::string& text, const std::string& want) {
+  Value value = json.Parse(text);
+  if (value.ErrorMessage().find(want) == std::string::npos) {
+    std::cerr << text << ": got " << value.object()->Inspect() << ", want an error with \"" << want << "\""
+              << std::endl;
+    ++failures;
+  }
+}
+
+void ExpectRoundTrip(Json& json, const std::string& text) {
+  Value value = json.RoundTrip(text);
+  if (!value.IsString() || value.AsString() != text) {
+    std::cerr << text << ": stringified as " << value.object()->Inspect() << std::endl;
+    ++failures;
+  }
+}
+
+void CheckNumbers(Json& json) {
+  for (const char* text : {"0", "-0", "7", "-12", "0.5", "-0.5", "1.25e3", "1E-2", "2e+8", "9223372036854775807"}) {
+    Value value = json.Parse(text);
+    if (!value.IsInteger() && !value.IsFloat()) {
+      std::cerr << text << ": got " << value.object()->Inspect() << ", want a number" << std::endl;
+      ++failures;
+    }
+  }
+  for (const char* text : {".5", "-.5", "1.", "-1.", "1.e5", "01", "-01", "-", "+1", "1e", "1e+", "1.5e", "inf",
+                           "nan", "0x10", "[1.]", "{\"a\":.5}"}) {
+    ExpectRejected(json, text, "invalid");
+  }
+}
+
+void CheckStrings(Json& json) {
+  ExpectString(json, "\"a\\u0001b\"", "a\x01" "b");
+  ExpectLast(json, "[\n\t1,\r\n\t\"tab\\tand newline\"\n]", "tab\tand newline");
+  ExpectRejected(json, "\"a\x01" "b\"", "control character in string at offset 2");
+  ExpectRejected(json, "\"a\tb\"", "control character");
+  ExpectRejected(json, "{\"k\n\": 1}", "control character");
+  // A surrogate pair is one code point, encoded as four UTF-8 bytes.
+  ExpectString(json, "\"\\ud83d\\ude00\"", "\xf0\x9f\x98\x80");
+  ExpectString(json, "\"x\\u00e9\\u20ac\"", "x\xc3\xa9\xe2\x82\xac");
+}
+
+// Backslashes and the quotes they escape, placed on both sides of every
+// block boundary the text reaches.
+void CheckEscapesAcrossBlocks(Json& json) {
+  for (size_t prefix = 0; prefix < 140; ++prefix) {
+    std::string pad(prefix, 'a');
+    ExpectString(json, "\"" + pad + "\\\"b\"", pad + "\"b");
+    ExpectString(json, "\"" + pad + "\\\\\"", pad + "\\");
+    ExpectString(json, "\"" + pad + "\\\\\\\"\"", pad + "\\\"");
+    ExpectLast(json, "[\"" + pad + "\\\\\", \"c\"]", "c");
+  }
+}
+
+void CheckDepth(Json& json) {
+  std::string nested = std::string(100, '[') + std::string(100, ']');
+  if (!json.Parse(nested).IsArray()) {
+    std::cerr << "100 nested arrays were refused" << std::endl;
+    ++failures;
+  }
+  ExpectRejected(json, std::string(5000, '[') + std::string(5000, ']'), "nesting too deep");
+  std::string objects;
+  for (int i = 0; i < 5000; ++i) {
+    objects += "{\"a\":";
+  }
+  objects += "1" + std::string(5000, '}');
+  ExpectRejected(json, objects, "nesting too deep");
+}
+
+void CheckRoundTrips(Json& json) {
+  ExpectRoundTrip(json, "[]");
+  ExpectRoundTrip(json, "{}");
+  ExpectRoundTrip(json, "[1,-2,0.5,-1.25,true,false,null]");
+  ExpectRoundTrip(json, "{\"name\":\"goku\",\"tags\":[\"a\",\"b\"],\"nested\":{\"x\":[[],{}]}}");
+  ExpectRoundTrip(json, "\"quote \\\" backslash \\\\ newline \\n control \\u0001\"");
+  ExpectRoundTrip(json, "\"\xf0\x9f\x98\x80\"");
+}
+
+}  // namespace
+
+int main() {
+  Json json;
+  CheckNumbers(json);
+  CheckStrings(json);
+  CheckEscapesAcrossBlocks(json);
+  CheckDepth(json);
+  CheckRoundTrips(json);
+  return failures == 0 ? 0 : 1;
+}
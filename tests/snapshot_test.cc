@@ -0,0 +1,155 @@
+// Saves a global environment to a snapshot, loads it into a fresh
+// interpreter and checks the restored closures still work, including ones
+// calling globals defined only after loading. Snapshots of another format
+// version or build, and truncated or corrupt ones, must be refused without
+// touching the globals, and rewriting a snapshot must not disturb
+// interpreters that loaded it.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include "interpreter.h"
+
+namespace {
+
+int failures = 0;
+
+// Offsets in the snapshot header, see snapshot.cc.
+const size_t kVersionOffset = 8;
+const size_t kFingerprintOffset = 12;
+const size_t kEnvironmentCountOffset = 20;
+
+void Expect(Interpreter& interpreter, const std::string& source, const std::string& expected) {
+  std::shared_ptr<Object> result = interpreter.Eval(source);
+  std::string actual = result == nullptr ? "(nothing)" : result->Inspect();
+  if (actual != expected) {
+    std::cerr << source << ": got " << actual << ", want " << expected << std::endl;
+    ++failures;
+  }
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(content.data(), content.size());
+}
+
+// Loading content must fail with an error containing want and leave the
+// globals as they were.
+void ExpectRefused(const std::string& what, const std::string& content, const std::string& want) {
+  std::string path = "goku_snapshot_test_bad.snap";
+  WriteFile(path, content);
+  Interpreter interpreter;
+  interpreter.Eval("let keep = 1;");
+  std::string error = interpreter.LoadSnapshot(path);
+  std::remove(path.c_str());
+  if (error.find(want) == std::string::npos) {
+    std::cerr << what << ": got \"" << error << "\", want \"" << want << "\"" << std::endl;
+    ++failures;
+  }
+  if (interpreter.globals()->objects.size() != 1) {
+    std::cerr << what << ": " << interpreter.globals()->objects.size() << " globals after a failed load"
+              << std::endl;
+    ++failures;
+  }
+  Expect(interpreter, "keep", "1");
+}
+
+void CheckRefused(const std::string& good) {
+  std::string content = good;
+  content[kVersionOffset] ^= 1;
+  ExpectRefused("other version", content, "incompatible build");
+
+  content = good;
+  content[kFingerprintOffset + 3] ^= 0x40;
+  ExpectRefused("other build", content, "incompatible build");
+
+  ExpectRefused("empty", "", "not a goku snapshot");
+  ExpectRefused("other magic", "GOKUSNAQ" + good.substr(8), "not a goku snapshot");
+
+  for (size_t size = 1; size < good.size(); ++size) {
+    ExpectRefused("truncated to " + std::to_string(size), good.substr(0, size), "snapshot");
+  }
+
+  content = good;
+  uint32_t count = 0xffffff;
+  std::memcpy(&content[kEnvironmentCountOffset], &count, sizeof(count));
+  ExpectRefused("environment count", content, "corrupt snapshot");
+
+  ExpectRefused("trailing bytes", good + "x", "corrupt snapshot");
+
+  // Every byte flipped in turn past the header: whatever still loads is
+  // fine, as long as nothing crashes and refused files change nothing.
+  for (size_t i = kEnvironmentCountOffset; i < good.size(); ++i) {
+    content = good;
+    content[i] ^= 0xff;
+    std::string path = "goku_snapshot_test_bad.snap";
+    WriteFile(path, content);
+    Interpreter interpreter;
+    interpreter.Eval("let keep = 1;");
+    if (!interpreter.LoadSnapshot(path).empty() && interpreter.globals()->objects.size() != 1) {
+      std::cerr << "byte " << i << " flipped: globals changed by a failed load" << std::endl;
+      ++failures;
+    }
+    std::remove(path.c_str());
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::string path = "goku_snapshot_test.snap";
+  {
+    Interpreter interpreter;
+    interpreter.Eval(
+        "let base = 10;"
+        "let add = fn(x) { x + base };"
+        "let run = fn() { hook() + 1 };"
+        "let counter = fn(start) { fn() { start + later } };"
+        "let from_five = counter(5);"
+        "let banner = \"a string long enough to stay in the mapping\";");
+    std::string error = interpreter.SaveSnapshot(path);
+    if (!error.empty()) {
+      std::cerr << "save: " << error << std::endl;
+      return 1;
+    }
+  }
+  std::string good = ReadFile(path);
+
+  Interpreter interpreter;
+  std::string error = interpreter.LoadSnapshot(path);
+  if (!error.empty()) {
+    std::cerr << "load: " << error << std::endl;
+    return 1;
+  }
+  Expect(interpreter, "add(1)", "11");
+  Expect(interpreter, "let hook = fn() { 41 }; run()", "42");
+  Expect(interpreter, "let later = 100; from_five()", "105");
+  Expect(interpreter, "counter(1)()", "101");
+
+  // Saving over the file must leave what this interpreter mapped alone.
+  {
+    Interpreter other;
+    other.Eval("let banner = \"x\";");
+    error = other.SaveSnapshot(path);
+    if (!error.empty()) {
+      std::cerr << "save over: " << error << std::endl;
+      ++failures;
+    }
+  }
+  Expect(interpreter, "banner", "a string long enough to stay in the mapping");
+  std::remove(path.c_str());
+
+  CheckRefused(good);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Runs task scripts that used to deadlock: a thread awaiting one task
+// must not get stuck in another one that blocks, and tasks blocked on a
+// channel must not keep their interpreter from going away. Run under
+// several GOKU_THREADS settings by ctest, each with a timeout.
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace {
+
+int failures = 0;
+
+void Expect(const std::string& source, const std::string& expected) {
+  Interpreter interpreter;
+  std::shared_ptr<Object> result = interpreter.Eval(source);
+  std::string actual = result == nullptr ? "(nothing)" : result->Inspect();
+  if (actual != expected) {
+    std::cerr << source << ": got " << actual << ", want " << expected << std::endl;
+    ++failures;
+  }
+}
+
+// Senders racing with Close: every send reported as done is received.
+void CheckCloseRace() {
+  for (int round = 0; round < 200; ++round) {
+    ChannelObject channel(64);
+    std::atomic<int> sent(0);
+    std::vector<std::thread> senders;
+    for (int i = 0; i < 2; ++i) {
+      senders.emplace_back([&channel, &sent]() {
+        while (channel.Send(std::make_shared<IntegerObject>(1)).empty()) {
+          sent.fetch_add(1);
+        }
+      });
+    }
+    int received = 0;
+    std::shared_ptr<Object> value;
+    for (int i = 0; i < 1000; ++i) {
+      channel.Recv(&value);
+      ++received;
+    }
+    channel.Close();
+    while (channel.Recv(&value).empty() && value != nullptr) {
+      ++received;
+    }
+    for (auto& sender : senders) {
+      sender.join();
+    }
+    if (received != sent.load()) {
+      std::cerr << "close race: sent " << sent.load() << ", received " << received << std::endl;
+      ++failures;
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckCloseRace();
+  {
+    // Destroying the interpreter cancels a task blocked on a channel
+    // nobody else can reach, instead of waiting for it forever.
+    Interpreter interpreter;
+    interpreter.Eval("let c = channel(); let t = spawn(fn() { recv(c) }); 1");
+  }
+  {
+    // Deadlines and cancellation reach operations blocked on a channel.
+    Interpreter interpreter;
+    BudgetOptions options;
+    options.timeout = std::chrono::milliseconds(50);
+    interpreter.SetBudget(options);
+    std::shared_ptr<Object> result = interpreter.Eval("let c = channel(); recv(c)");
+    if (result->Inspect().find("deadline") == std::string::npos) {
+      std::cerr << "recv past the deadline: got " << result->Inspect() << std::endl;
+      ++failures;
+    }
+    std::atomic<bool> cancel(false);
+    options = BudgetOptions();
+    options.cancel = &cancel;
+    interpreter.SetBudget(options);
+    std::thread canceller([&cancel]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      cancel.store(true);
+    });
+    result = interpreter.Eval("let d = channel(1); await(spawn(fn() { send(d, 1); send(d, 2); send(d, 3) }))");
+    canceller.join();
+    if (result->Inspect().find("cancelled") == std::string::npos) {
+      std::cerr << "send cancelled while blocked: got " << result->Inspect() << std::endl;
+      ++failures;
+    }
+  }
+
+  for (int i = 0; i < 30; ++i) {
+    // Awaiting ta must not pick up tb, which waits for a send that only
+    // follows the await.
+    Expect("let c = channel(1);"
+           "let slow = fn(n) { if (n < 1) { 0 } else { slow(n - 1) + 1 } };"
+           "let ta = spawn(fn() { let a = slow(300); let b = slow(300); let d = slow(300); a });"
+           "let tb = spawn(fn() { recv(c) });"
+           "let r = await(ta);"
+           "send(c, 7);"
+           "r * 100 + await(tb)",
+           "30007");
+    // The same with a parallel loop waiting for its chunks.
+    Expect("let c = channel(1);"
+           "let tb = spawn(fn() { recv(c) });"
+           "let n = len(pmap(range(0, 10000), fn(x) { x * 2 }));"
+           "send(c, 7);"
+           "n * 100 + await(tb)",
+           "1000007");
+  }
+  return failures == 0 ? 0 : 1;
+}